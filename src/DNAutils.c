@@ -32,7 +32,7 @@ int bases_match(char a, char b, int dir_prod){
   of the k-mer and returns a copy of the k-mer.*/
 char *get_kmer(char *DNA_string, int k){
     int i = 0;
-    char *kmer = malloc(k*sizeof(*kmer));
+    char *kmer = malloc((k+1)*sizeof(*kmer));
     assert(kmer);
 
     for (i = 0; i < k; i++)
@@ -44,7 +44,7 @@ char *get_kmer(char *DNA_string, int k){
 /*Takes in a k-mer and its length and returns the k-mer's reverse complement.*/
 char *kmer_revcomp(char *kmer, int k){
     int i = 0;
-    char *revcomp = malloc(k*sizeof(*revcomp));
+    char *revcomp = malloc((k+1)*sizeof(*revcomp));
     assert(revcomp);
 
     for (i = 0; i < k; i++)
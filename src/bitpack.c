@@ -44,11 +44,12 @@ char *read_int_to_bytes(uint64_t number, int length){
 /*Takes in an integer in unint64_t format, the number of bytes in that int,
   and a file pointer and outputs the int to the file.*/
 void output_int_to_file(uint64_t number, int length, FILE *f){
+    char bytes[8];
     int i;
-    char *bytes = read_int_to_bytes(number, length);
-    for (i = 0; i < length; i++)
-        putc(bytes[i], f);
-    free(bytes);
+
+    for (i = length-1; i >= 0; i--, number >>= 8)
+        bytes[i] = (char)(number & 0xff);
+    fwrite(bytes, sizeof(*bytes), length, f);
 }
 
 /*Takes in a number of bytes to read and a file pointer and reads that number
@@ -66,3 +67,109 @@ uint64_t read_int_from_file(int length, FILE *f){
     }
     return bytes;
 }
+
+/*Takes in a pointer to an integer of "length" bytes stored with its most
+  significant byte first, as output_int_to_file writes it, and returns it as a
+  64-bit integer.  Used for files that are mapped into memory.*/
+uint64_t read_int_from_bytes(unsigned char *bytes, int length){
+    uint64_t n = (uint64_t)0;
+    int i;
+
+    for (i = 0; i < length; i++)
+        n = (n << 8) | bytes[i];
+    return n;
+}
+
+/*Varints store an unsigned integer in 7 bits per byte, lowest bits first,
+ *with the high bit set on every byte but the last, so small numbers take a
+ *single byte.
+ */
+
+/*Returns the number of bytes in the varint for n.*/
+int32_t varint_size(uint32_t n){
+    int32_t size = 1;
+
+    for (; n >= 0x80; n >>= 7)
+        size++;
+    return size;
+}
+
+/*Writes n as a varint at buf[pos] and returns the position after it.*/
+int32_t put_varint(char *buf, int32_t pos, uint32_t n){
+    for (; n >= 0x80; n >>= 7)
+        buf[pos++] = (char)((n & 0x7f) | 0x80);
+    buf[pos++] = (char)n;
+    return pos;
+}
+
+/*Reads a varint at buf[*pos] and moves pos past it.*/
+uint32_t get_varint(char *buf, int *pos){
+    uint32_t n = 0;
+    int shift = 0;
+    unsigned char b;
+
+    do {
+        b = (unsigned char)buf[(*pos)++];
+        n |= ((uint32_t)(b & 0x7f)) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return n;
+}
+
+/*Zigzag encoding maps signed integers to unsigned integers so that numbers
+  close to 0 on either side get small varints: 0, -1, 1, -2 become 0, 1, 2, 3.*/
+uint32_t zigzag(int32_t n){
+    return n < 0 ? ((uint32_t)(-(n + 1)) << 1) | 1 : (uint32_t)n << 1;
+}
+
+int32_t unzigzag(uint32_t n){
+    return (n & 1) ? -(int32_t)(n >> 1) - 1 : (int32_t)(n >> 1);
+}
+
+/*Outputs n to a file as a varint.*/
+void output_varint_to_file(uint32_t n, FILE *f){
+    char bytes[5];
+    fwrite(bytes, sizeof(*bytes), put_varint(bytes, 0, n), f);
+}
+
+/*Reads a varint from a file.  Returns 0 at the end of the file, so callers
+  need to check feof.*/
+uint32_t read_varint_from_file(FILE *f){
+    uint32_t n = 0;
+    int shift = 0, c;
+
+    do {
+        if (EOF == (c = getc(f)))
+            return 0;
+        n |= ((uint32_t)(c & 0x7f)) << shift;
+        shift += 7;
+    } while (c & 0x80);
+    return n;
+}
+
+/*Outputs the header at the start of a versioned database file: a magic
+  string followed by a byte with the version of the file's format.*/
+void output_format_header(const char *magic, int version, FILE *f){
+    fputs(magic, f);
+    putc(version, f);
+}
+
+/*Reads the header written by output_format_header and returns the version of
+ *the file's format.  Files made before the formats were versioned have no
+ *header; for those, f is put back at the start of the file and 1 is
+ *returned.
+ */
+int read_format_header(const char *magic, FILE *f){
+    int i, c;
+
+    for (i = 0; magic[i] != '\0'; i++)
+        if ((c = getc(f)) != (unsigned char)magic[i]) {
+            fseek(f, 0, SEEK_SET);
+            return 1;
+        }
+    if (EOF == (c = getc(f))) {
+        fseek(f, 0, SEEK_SET);
+        return 1;
+    }
+    return c;
+}
@@ -10,5 +10,15 @@ uint64_t shift_right(uint64_t x, int bits);
 char *read_int_to_bytes(uint64_t number, int bytes);
 void output_int_to_file(uint64_t number, int length, FILE *f);
 uint64_t read_int_from_file(int length, FILE *f);
+uint64_t read_int_from_bytes(unsigned char *bytes, int length);
+int32_t varint_size(uint32_t n);
+int32_t put_varint(char *buf, int32_t pos, uint32_t n);
+uint32_t get_varint(char *buf, int *pos);
+uint32_t zigzag(int32_t n);
+int32_t unzigzag(uint32_t n);
+void output_varint_to_file(uint32_t n, FILE *f);
+uint32_t read_varint_from_file(FILE *f);
+void output_format_header(const char *magic, int version, FILE *f);
+int read_format_header(const char *magic, FILE *f);
 
 #endif
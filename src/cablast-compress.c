@@ -14,6 +14,7 @@
 #include "DNAalphabet.h"
 #include "fasta.h"
 #include "flags.h"
+#include "names_file.h"
 #include "seq.h"
 #include "util.h"
 
@@ -35,10 +36,12 @@ main(int argc, char **argv)
     struct cb_compress_workers *workers;
     struct opt_config *conf;
     struct opt_args *args;
-    struct fasta_seq_gen *fsg;
+    struct fasta_seq_gen **fsgs;
     struct fasta_seq *seq;
     struct cb_seq *org_seq;
-    int i, org_seq_id;
+    FILE *fnames;
+    char **names, *pnames;
+    int i, org_seq_id, num_files, readers, names_allocated, name_length;
     struct timeval start, current;
     long double elapsed;
     conf = load_compress_args();
@@ -52,18 +55,47 @@ main(int argc, char **argv)
     }
 
     db = cb_database_init(args->args[0], compress_flags.map_seed_size, false);
+    db->com_db->checkpoint_interval = compress_flags.checkpoint_interval;
     workers = cb_compress_start_workers(db, compress_flags.procs);
 
+    /*Up to "readers" files are parsed at once, each by its own generator, but
+     *sequences are sent to the workers one file at a time in the order the
+     *files were listed, so every sequence gets the same ID on every run.
+     *A generator for the next file is started as soon as one is finished.
+     */
+    num_files = args->nargs - 1;
+    readers = compress_flags.read_procs < 1 ? 1 : compress_flags.read_procs;
+    fsgs = malloc(num_files * sizeof(*fsgs));
+    assert(fsgs);
+    for (i = 0; i < num_files && i < readers; i++)
+        fsgs[i] = fasta_generator_start(
+            args->args[i+1], FASTA_EXCLUDE_NCBI_BLOSUM62, 100,
+            compress_flags.procs);
+
+    /*The name of every sequence, up to its first space, is kept for the
+      name index that cablast-decompress uses to find sequences by name.*/
+    names_allocated = 1024;
+    names = malloc(names_allocated * sizeof(*names));
+    assert(names);
+
     org_seq_id = 0;
     gettimeofday(&start, NULL);
-    for (i = 1; i < args->nargs; i++) {
-        fsg = fasta_generator_start(
-            args->args[i], FASTA_EXCLUDE_NCBI_BLOSUM62, 100);
-
-        while (NULL != (seq = fasta_generator_next(fsg))) {
+    for (i = 0; i < num_files; i++) {
+        while (NULL != (seq = fasta_generator_next(fsgs[i]))) {
             org_seq = cb_seq_init(org_seq_id, seq->name, seq->seq);
             cb_compress_send_job(workers, org_seq);
 
+            if (org_seq_id == names_allocated) {
+                names_allocated *= 2;
+                names = realloc(names, names_allocated * sizeof(*names));
+                assert(names);
+            }
+            name_length = strcspn(seq->name, " \t");
+            names[org_seq_id] = malloc((name_length + 1) * sizeof(**names));
+            assert(names[org_seq_id]);
+            memcpy(names[org_seq_id], seq->name, name_length);
+            names[org_seq_id][name_length] = '\0';
+
             fasta_free_seq(seq);
 
             org_seq_id++;
@@ -75,14 +107,33 @@ main(int argc, char **argv)
             }
         }
 
-        fasta_generator_free(fsg);
+        fasta_generator_free(fsgs[i]);
+        if (i + readers < num_files)
+            fsgs[i+readers] = fasta_generator_start(
+                args->args[i+readers+1], FASTA_EXCLUDE_NCBI_BLOSUM62, 100,
+                compress_flags.procs);
     }
+    free(fsgs);
 
     cb_compress_join_workers(workers);
+    if (compress_flags.print_compress_stats)
+        cb_compress_print_stats(workers, stderr);
     cb_coarse_save_binary(db->coarse_db);
-    cb_coarse_save_seeds_binary(db->coarse_db);
+    cb_coarse_save_seeds_binary(db->coarse_db, compress_flags.procs);
     cb_compressed_save_binary(db->com_db);
 
+    pnames = path_join(args->args[0], CABLAST_COMPRESSED_NAMES);
+    if (NULL == (fnames = fopen(pnames, "w"))) {
+        fprintf(stderr, "Could not open '%s' for writing.\n", pnames);
+        exit(1);
+    }
+    cb_names_file_write(names, org_seq_id, fnames);
+    fclose(fnames);
+    for (i = 0; i < org_seq_id; i++)
+        free(names[i]);
+    free(names);
+    free(pnames);
+
     char *coarse_filename = path_join(args->args[0], "coarse.fasta");
     int len_filename = strlen(coarse_filename);
     int len_command = strlen("makeblastdb -dbtype nucl -in  -out") +
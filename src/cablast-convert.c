@@ -0,0 +1,137 @@
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "opt.h"
+
+#include "coarse.h"
+#include "compressed.h"
+#include "database.h"
+#include "flags.h"
+#include "seeds_file.h"
+
+static char *path_join(char *a, char *b)
+{
+    char *joined;
+
+    joined = malloc((1 + strlen(a) + 1 + strlen(b)) * sizeof(*joined));
+    assert(joined);
+
+    sprintf(joined, "%s/%s", a, b);
+    return joined;
+}
+
+static FILE *open_file(char *path, char *mode)
+{
+    FILE *f = fopen(path, mode);
+
+    if (f == NULL) {
+        fprintf(stderr, "Could not open '%s': %s\n", path, strerror(errno));
+        exit(1);
+    }
+    return f;
+}
+
+/*Renames a file written next to a database file over that file.*/
+static void replace_file(char *new_path, char *path)
+{
+    if (0 != rename(new_path, path)) {
+        fprintf(stderr, "Could not replace '%s': %s\n", path, strerror(errno));
+        exit(1);
+    }
+}
+
+/*Rewrites the compressed.cb, coarse.links and coarse.seeds files of a
+  database made by an older version of cablast-compress in the current format,
+  along with their indexes and the sequence lengths.  Edit scripts get
+  checkpoints if --checkpoint-interval is given, and old seed files are read
+  with the seed size given by --map-seed-size.*/
+int
+main(int argc, char **argv)
+{
+    struct opt_config *conf;
+    struct opt_args *args;
+    char *pcompressed, *pindex, *plengths, *plinks, *plinks_index, *pseeds;
+    char *pcompressed_new, *pindex_new, *plengths_new, *plinks_new,
+         *plinks_index_new, *pseeds_new;
+    FILE *compressed, *compressed_new, *index_new, *lengths_new,
+         *links, *links_new, *links_index_new, *seeds, *seeds_new;
+    int32_t num_seqs, num_coarse_seqs;
+
+    conf = load_compress_args();
+    args = opt_config_parse(conf, argc, argv);
+    if (args->nargs < 1) {
+        fprintf(stderr, "Usage: %s [flags] database-dir\n", argv[0]);
+        exit(1);
+    }
+
+    pcompressed = path_join(args->args[0], CABLAST_COMPRESSED);
+    pindex = path_join(args->args[0], CABLAST_COMPRESSED_INDEX);
+    plengths = path_join(args->args[0], CABLAST_COMPRESSED_LENGTHS);
+    plinks = path_join(args->args[0], CABLAST_COARSE_LINKS);
+    plinks_index = path_join(args->args[0], CABLAST_COARSE_LINKS_INDEX);
+    pseeds = path_join(args->args[0], CABLAST_COARSE_SEEDS);
+    pcompressed_new = path_join(args->args[0], CABLAST_COMPRESSED ".new");
+    pindex_new = path_join(args->args[0], CABLAST_COMPRESSED_INDEX ".new");
+    plengths_new = path_join(args->args[0], CABLAST_COMPRESSED_LENGTHS ".new");
+    plinks_new = path_join(args->args[0], CABLAST_COARSE_LINKS ".new");
+    plinks_index_new = path_join(args->args[0],
+                                 CABLAST_COARSE_LINKS_INDEX ".new");
+    pseeds_new = path_join(args->args[0], CABLAST_COARSE_SEEDS ".new");
+
+    compressed = open_file(pcompressed, "r");
+    compressed_new = open_file(pcompressed_new, "w");
+    index_new = open_file(pindex_new, "w");
+    lengths_new = open_file(plengths_new, "w");
+    links = open_file(plinks, "r");
+    links_new = open_file(plinks_new, "w");
+    links_index_new = open_file(plinks_index_new, "w");
+    seeds = open_file(pseeds, "r");
+    seeds_new = open_file(pseeds_new, "w");
+
+    num_seqs = cb_compressed_convert(compressed, compressed_new, index_new,
+                                     lengths_new,
+                                     compress_flags.checkpoint_interval);
+    num_coarse_seqs = cb_coarse_links_convert(links, links_new,
+                                              links_index_new);
+    cb_seeds_file_convert(seeds, seeds_new, compress_flags.map_seed_size,
+                          compress_flags.procs);
+
+    fclose(compressed);
+    fclose(compressed_new);
+    fclose(index_new);
+    fclose(lengths_new);
+    fclose(links);
+    fclose(links_new);
+    fclose(links_index_new);
+    fclose(seeds);
+    fclose(seeds_new);
+
+    replace_file(pcompressed_new, pcompressed);
+    replace_file(pindex_new, pindex);
+    replace_file(plengths_new, plengths);
+    replace_file(plinks_new, plinks);
+    replace_file(plinks_index_new, plinks_index);
+    replace_file(pseeds_new, pseeds);
+    fprintf(stderr, "Converted %d sequences and %d coarse sequences.\n",
+            num_seqs, num_coarse_seqs);
+
+    free(pcompressed);
+    free(pindex);
+    free(plengths);
+    free(plinks);
+    free(plinks_index);
+    free(pseeds);
+    free(pcompressed_new);
+    free(pindex_new);
+    free(plengths_new);
+    free(plinks_new);
+    free(plinks_index_new);
+    free(pseeds_new);
+    opt_config_free(conf);
+    opt_args_free(args);
+
+    return 0;
+}
@@ -3,18 +3,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
-#include <unistd.h>
 
 #include "opt.h"
 
 #include "coarse.h"
+#include "coarse_cache.h"
 #include "compressed.h"
 #include "database.h"
-#include "edit_scripts.h"
+#include "decompression.h"
 #include "flags.h"
-#include "fasta.h"
-#include "seq.h"
+#include "names_file.h"
 
 static char *path_join(char *a, char *b)
 {
@@ -27,91 +25,203 @@ static char *path_join(char *a, char *b)
     return joined;
 }
 
+/*Maps the name index of the database in dir, setting *f to its file.  A
+ *database made before compressed.cb.names existed gets one now, or a
+ *temporary one if the database directory cannot be written to.
+ */
+static struct cb_names_file *
+open_names(struct cb_database *db, char *dir, FILE **f)
+{
+    struct cb_names_file *names_file;
+    char *path = path_join(dir, CABLAST_COMPRESSED_NAMES);
+    char **headers;
+    int32_t count, i;
+
+    *f = fopen(path, "r");
+    if (NULL != (names_file = cb_names_file_init(*f))) {
+        free(path);
+        return names_file;
+    }
+    if (*f != NULL)
+        fclose(*f);
+
+    headers = cb_compressed_read_headers(db->com_db, &count);
+    if (NULL == (*f = fopen(path, "w+")) && NULL == (*f = tmpfile())) {
+        fprintf(stderr, "Could not create a name index for '%s'.\n", dir);
+        exit(1);
+    }
+    cb_names_file_write(headers, count, *f);
+    fflush(*f);
+    for (i = 0; i < count; i++)
+        free(headers[i]);
+    free(headers);
+    free(path);
+
+    if (NULL == (names_file = cb_names_file_init(*f))) {
+        fprintf(stderr, "Could not read the name index for '%s'.\n", dir);
+        exit(1);
+    }
+    return names_file;
+}
+
+/*Appends id to the list of IDs in *ids, which has room for *allocated.*/
+static void
+add_id(int32_t **ids, int32_t *num_ids, int32_t *allocated, int32_t id)
+{
+    if (*num_ids == *allocated) {
+        *allocated = *allocated == 0 ? 16 : 2 * *allocated;
+        *ids = realloc(*ids, *allocated * sizeof(**ids));
+        assert(*ids);
+    }
+    (*ids)[(*num_ids)++] = id;
+}
+
+/*Returns the IDs of the sequences chosen with --ids and then with --names,
+  in that order, and sets *num_ids to the number of them.*/
+static int32_t *
+chosen_ids(struct cb_database *db, char *dir,
+           struct cb_names_file **names_file, FILE **fnames,
+           int32_t *num_ids)
+{
+    int32_t *ids = NULL;
+    int32_t allocated = 0, first, count, i;
+    char *list, *item, *end;
+    long id;
+
+    *num_ids = 0;
+
+    list = malloc((strlen(decompress_flags.ids) + 1) * sizeof(*list));
+    assert(list);
+    strcpy(list, decompress_flags.ids);
+    for (item = strtok(list, ","); item != NULL; item = strtok(NULL, ",")) {
+        id = strtol(item, &end, 10);
+        if (end == item || *end != '\0' || id < 0) {
+            fprintf(stderr, "'%s' is not a sequence ID.\n", item);
+            exit(1);
+        }
+        add_id(&ids, num_ids, &allocated, (int32_t)id);
+    }
+    free(list);
+
+    list = malloc((strlen(decompress_flags.names) + 1) * sizeof(*list));
+    assert(list);
+    strcpy(list, decompress_flags.names);
+    for (item = strtok(list, ","); item != NULL; item = strtok(NULL, ",")) {
+        if (*names_file == NULL)
+            *names_file = open_names(db, dir, fnames);
+        if (0 == (count = cb_names_file_find(*names_file, item, &first))) {
+            fprintf(stderr, "There is no sequence named '%s'.\n", item);
+            exit(1);
+        }
+        for (i = first; i < first + count; i++)
+            add_id(&ids, num_ids, &allocated,
+                   cb_names_file_id(*names_file, i));
+    }
+    free(list);
+
+    return ids;
+}
+
+/*Writes the regions chosen with --region, each of which is name:start-end
+ *with 1-based, inclusive coordinates.  A region that runs past the end of its
+ *sequence is cut short there, and its header has the coordinates of what was
+ *written.  A region that starts past the end is an error.
+ */
+static void
+write_regions(struct cb_database *db, char *dir,
+              struct cb_names_file **names_file, FILE **fnames, FILE *out)
+{
+    char *list, *item, *colon, *residues;
+    int32_t first;
+    long start, end;
+
+    list = malloc((strlen(decompress_flags.region) + 1) * sizeof(*list));
+    assert(list);
+    strcpy(list, decompress_flags.region);
+    for (item = strtok(list, ","); item != NULL; item = strtok(NULL, ",")) {
+        colon = strrchr(item, ':');
+        if (colon == NULL || 2 != sscanf(colon + 1, "%ld-%ld", &start, &end) ||
+              start < 1 || end < start) {
+            fprintf(stderr, "'%s' is not a region of the form "
+                            "name:start-end.\n", item);
+            exit(1);
+        }
+        *colon = '\0';
+
+        if (*names_file == NULL)
+            *names_file = open_names(db, dir, fnames);
+        if (0 == cb_names_file_find(*names_file, item, &first)) {
+            fprintf(stderr, "There is no sequence named '%s'.\n", item);
+            exit(1);
+        }
+        residues = cb_decompress_range(db->coarse_db, db->com_db,
+                                       cb_names_file_id(*names_file, first),
+                                       start - 1, end);
+        if (residues == NULL || residues[0] == '\0') {
+            fprintf(stderr, "Region %ld-%ld is past the end of '%s'.\n",
+                    start, end, item);
+            exit(1);
+        }
+        end = start + (long)strlen(residues) - 1;
+        fprintf(out, "> %s:%ld-%ld\n%s\n", item, start, end, residues);
+        free(residues);
+    }
+    free(list);
+}
+
 int
 main(int argc, char **argv)
-{ 
+{
     struct cb_database *db;
     struct opt_config *conf;
     struct opt_args *args;
-    struct fasta_seq_gen *fsg;
-    struct fasta_seq *seq;
-    int i, org_seq_id;
-    struct timeval start;
-    conf = load_compress_args();
+    struct cb_names_file *names_file = NULL;
+    FILE *fnames = NULL, *out;
+    int32_t *ids, num_ids;
+    conf = load_decompress_args();
     args = opt_config_parse(conf, argc, argv);
     if (args->nargs < 2) {
-        fprintf(stderr, 
+        fprintf(stderr,
             "Usage: %s [flags] database-dir output-fasta-file\n",
             argv[0]);
+        opt_config_print_usage(conf);
         exit(1);
     }
 
-    db = cb_database_read(args->args[0], compress_flags.map_seed_size);
-
-    org_seq_id = 0;
-    gettimeofday(&start, NULL);
-    char *compressed_filename = path_join(args->args[0], CABLAST_COMPRESSED);
-    FILE *compressed_file = fopen(compressed_filename, "r");
-    struct cb_compressed_seq **compressed = read_compressed(compressed_file);
-    struct fasta_seq **coarse_sequences;
-    uint64_t num_coarse_sequences = 0;
-    uint64_t last_end;
-    int overlap;
-    struct cb_link_to_coarse *link;
-
-    coarse_sequences = malloc(10000*sizeof(*coarse_sequences));
-    assert(coarse_sequences);
-
-
-    fsg = fasta_generator_start(path_join(args->args[0],CABLAST_COARSE_FASTA),
-                                FASTA_EXCLUDE_NCBI_BLOSUM62, 100);
-    while (NULL != (seq = fasta_generator_next(fsg)))
-        coarse_sequences[num_coarse_sequences++] = seq;
-    for (i = 0; compressed[i] != NULL; i++) {
-        int current_chunk = 0;
-        last_end = 0;
-        printf("> %s\n", compressed[i]->name);
-        for (link = (compressed[i])->links; link != NULL; link = link->next) {
-            int length;
-
-            /*overlap represents the length of the overlap of the parts of the
-              decompressed sequence that has been printed and the parts of the
-              decompressed sequence currently being decompressed.*/
-            overlap = last_end - link->original_start;
-            struct cb_seq *chunk =
-                cb_seq_init_range(-1, "",
-                                   coarse_sequences[link->coarse_seq_id]->seq,
-                                   link->coarse_start, link->coarse_end + 1);
-            for (length = 0; chunk->residues[length] != '\0'; length++);
-
-            char *decompressed = read_edit_script(link->diff, chunk->residues,
-                                                                      length);
-
-            /*Print all characters of the decompressed chunk past the index
-              "overlap" unless overlap is greater than the length of the
-              decompressed chunk.*/
-
-            decompressed += overlap;
-            if (overlap < link->original_end - link->original_start)
-                printf("%s", decompressed);
-            decompressed -= overlap;
-            free(decompressed);
-
-            if (link->original_end > last_end)
-                last_end = link->original_end + 1;
-
-            cb_seq_free(chunk);
-
-            current_chunk++;
-        }
-        putc('\n', stdout);
-    }
+    db = cb_database_read(args->args[0]);
 
-    fasta_generator_free(fsg);
-    for(i = 0; i < num_coarse_sequences; i++)
-        free(coarse_sequences[i]);
-    free(coarse_sequences);
+    /*An output file of "-" writes to stdout.*/
+    if (0 == strcmp(args->args[1], "-"))
+        out = stdout;
+    else if (NULL == (out = fopen(args->args[1], "w"))) {
+        fprintf(stderr, "Could not open '%s' for writing.\n", args->args[1]);
+        exit(1);
+    }
 
+    /*Without packed residues every link would read its whole coarse sequence
+      from coarse.fasta, so recently used coarse sequences are cached.*/
+    if (db->coarse_db->packed == NULL)
+        db->coarse_db->cache =
+            cb_coarse_cache_init(CABLAST_DECOMPRESS_CACHE_SIZE);
+
+    ids = chosen_ids(db, args->args[0], &names_file, &fnames, &num_ids);
+    if (num_ids > 0)
+        cb_decompress_write(db->coarse_db, db->com_db, ids, num_ids, out,
+                            decompress_flags.procs);
+    if (decompress_flags.region[0] != '\0')
+        write_regions(db, args->args[0], &names_file, &fnames, out);
+    if (num_ids == 0 && decompress_flags.region[0] == '\0')
+        cb_decompress_write(db->coarse_db, db->com_db, NULL, 0, out,
+                            decompress_flags.procs);
+    if (out != stdout)
+        fclose(out);
+    else
+        fflush(stdout);
+
+    free(ids);
+    cb_names_file_free(names_file);
+    if (fnames != NULL)
+        fclose(fnames);
     cb_database_free(db);
     opt_config_free(conf);
     opt_args_free(args);
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,7 +21,6 @@
 #include "DNAalphabet.h"
 #include "fasta.h"
 #include "flags.h"
-#include "range_tree.h"
 #include "seq.h"
 #include "util.h"
 #include "xml.h"
@@ -195,22 +195,18 @@ struct DSVector *get_blast_iterations(xmlNode *node){
     return iterations;
 }
 
-/*Takes in a hash map of range trees created from the expanded BLAST hits
- *for each original sequence and outputs them to the FASTA file
- *CaBLAST_fine.fasta
+/*Takes in the expansions of the merged windows of original sequences that
+ *coarse BLAST hits were expanded to, in order of original sequence and start,
+ *and outputs them to the FASTA file CaBLAST_fine.fasta.
  */
-void write_fine_db(struct DSHashMap *range_trees){
+void write_fine_db(struct cb_hit_expansion **expansions, int64_t count){
     FILE *tree_expansions = fopen("CaBLAST_fine.fasta", "w");
-    int i = 0;
+    int64_t i = 0;
 
-    ds_hashmap_sort_keys(range_trees);
-    for (i = 0; i < range_trees->keys->size; i++){
-        int32_t key =
-            ((struct DSHashKey *)ds_vector_get(range_trees->keys, i))->key.i;
-        struct cb_range_tree *tree =
-            (struct cb_range_tree *)ds_geti(range_trees, key);
-        cb_range_tree_output_fasta(tree, tree_expansions);
-    }
+    for (i = 0; i < count; i++)
+        if (expansions[i] != NULL)
+            fprintf(tree_expansions, "> %s\n%s\n", expansions[i]->seq->name,
+                    expansions[i]->seq->residues);
     fclose(tree_expansions);
 
     system("makeblastdb -dbtype nucl -in CaBLAST_fine.fasta -out "
@@ -265,40 +261,142 @@ bool has_blast_arg(struct opt_args *args, char *arg){
     return false;
 }
 
-/*Takes in as input the vector of iterations from coarse BLAST, an index into
- *the vector (representing the index of which query we want to get the results
- *from), and the database we are using for search and returns a vector of
- *every original sequence section re-created from the calls to
- *cb_coarse_expand for the hits in the iteration we are expanding.
+/*The state shared by the threads of expand_windows.  Each thread takes the
+ *next window that has not been taken yet and decodes it into the slot of
+ *"expansions" with the same index, so the threads share nothing else but the
+ *databases.
+ */
+struct expand_pool {
+    struct cb_database *db;
+    struct cb_expansion_window *windows;
+    struct cb_hit_expansion **expansions;
+    int64_t num_windows;
+    int64_t next;
+    pthread_mutex_t lock;
+};
+
+char *progress_bar(int current, int iterations);
+
+/*Shows the iteration with index current on the progress bar.*/
+void show_progress(int current, int iterations){
+    char *bar = progress_bar(current, iterations);
+
+    fprintf(stderr, "\r");
+    fprintf(stderr, "iteration: %d/%d", current+1, iterations);
+    fprintf(stderr, " %s", bar);
+    free(bar);
+}
+
+/*Takes in as input the vector of iterations from coarse BLAST and the
+ *database we are using for search and returns a vector of the windows of
+ *original sequences that the HSPs of every hit in every iteration expand to,
+ *from the calls to cb_coarse_expand_windows.  Nothing is decoded yet.
  */
-struct DSVector *expand_blast_hits(struct DSVector *iterations, int index,
-                                   struct cb_database *db,
-                                   struct DSHashMap *range_trees){
-    struct DSVector *expanded_hits = ds_vector_create();
-    int i = 0, j = 0, k = 0;
-    struct DSVector *hits = get_blast_hits((xmlNode *)
-                                ds_vector_get(iterations, index));
-    for (i = 0; i < hits->size; i++) {
-        struct hit *current_hit = (struct hit *)ds_vector_get(hits, i);
-        struct DSVector *hsps = current_hit->hsps;
-        for (j = 0; j < hsps->size; j++) {
-            struct hsp *h = (struct hsp *)ds_vector_get(hsps, j);
-            int32_t coarse_start = h->hit_from-1;
-            int32_t coarse_end = h->hit_to-1;
-            int32_t coarse_seq_id = current_hit->accession;
-            struct DSVector *oseqs =
-                cb_coarse_expand(db->coarse_db, db->com_db,
-                                 range_trees, coarse_seq_id,
-                                 coarse_start, coarse_end, 50);
-            for (k = 0; k < oseqs->size; k++)
-                ds_vector_append(expanded_hits, ds_vector_get(oseqs, k));
-            ds_vector_free_no_data(oseqs);
+struct DSVector *get_expansion_windows(struct DSVector *iterations,
+                                       struct cb_database *db){
+    struct DSVector *windows = ds_vector_create(), *hsp_windows;
+    struct DSVector *hits;
+    struct hit *current_hit;
+    struct hsp *h;
+    int i = 0, j = 0, k = 0, l = 0;
+
+    for (i = 0; i < iterations->size; i++) {
+        /*If the show-progress flag is activated, display the progress bar*/
+        if (!search_flags.hide_messages)
+            show_progress(i, iterations->size);
+
+        hits = get_blast_hits((xmlNode *)ds_vector_get(iterations, i));
+        for (j = 0; j < hits->size; j++) {
+            current_hit = (struct hit *)ds_vector_get(hits, j);
+            for (k = 0; k < current_hit->hsps->size; k++) {
+                h = (struct hsp *)ds_vector_get(current_hit->hsps, k);
+                hsp_windows = cb_coarse_expand_windows(db->coarse_db,
+                                                       db->com_db,
+                                                       current_hit->accession,
+                                                       h->hit_from-1,
+                                                       h->hit_to-1, 50);
+                for (l = 0; l < hsp_windows->size; l++)
+                    ds_vector_append(windows, ds_vector_get(hsp_windows, l));
+                ds_vector_free_no_data(hsp_windows);
+            }
+            ds_vector_free(current_hit->hsps);
+            free(current_hit);
         }
-        ds_vector_free(current_hit->hsps);
-        free(current_hit);
+        ds_vector_free_no_data(hits);
     }
-    ds_vector_free_no_data(hits);
-    return expanded_hits;
+    return windows;
+}
+
+/*Takes the windows of a pool one at a time until there are none left.*/
+void *expand_worker(void *data){
+    struct expand_pool *pool = (struct expand_pool *)data;
+    int64_t i;
+
+    while (true) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->next == pool->num_windows) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        i = pool->next++;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->expansions[i] = cb_expand_window(pool->db->coarse_db,
+                                               pool->db->com_db,
+                                               &pool->windows[i]);
+    }
+    return NULL;
+}
+
+/*Takes in the database we are using for search, an array of merged windows
+ *from cb_merge_windows and a number of threads, and returns an array with the
+ *expansion of each window, decoded once by a pool of "threads" threads.  An
+ *expansion is NULL if its sequence could not be read.
+ */
+struct cb_hit_expansion **expand_windows(struct cb_database *db,
+                                         struct cb_expansion_window *windows,
+                                         int64_t num_windows,
+                                         int32_t threads){
+    struct expand_pool pool;
+    pthread_t *workers;
+    int32_t errno;
+    int i = 0;
+
+    if (threads < 1)
+        threads = 1;
+
+    pool.db = db;
+    pool.windows = windows;
+    pool.num_windows = num_windows;
+    pool.next = 0;
+    pool.expansions = malloc((num_windows + 1) * sizeof(*pool.expansions));
+    assert(pool.expansions);
+    if (0 != (errno = pthread_mutex_init(&pool.lock, NULL))) {
+        fprintf(stderr, "Could not create mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+
+    workers = malloc(threads * sizeof(*workers));
+    assert(workers);
+    for (i = 0; i < threads; i++)
+        if (0 != (errno = pthread_create(&workers[i], NULL, expand_worker,
+                                         &pool))) {
+            fprintf(stderr,
+                "expand_windows: Could not start thread. Errno: %d\n",
+                errno);
+            exit(1);
+        }
+    for (i = 0; i < threads; i++)
+        if (0 != (errno = pthread_join(workers[i], NULL))) {
+            fprintf(stderr,
+                "expand_windows: Could not join thread. Errno: %d\n",
+                errno);
+            exit(1);
+        }
+
+    pthread_mutex_destroy(&pool.lock);
+    free(workers);
+    return pool.expansions;
 }
 
 char *progress_bar(int current, int iterations){
@@ -317,24 +415,28 @@ char *progress_bar(int current, int iterations){
     return bar;
 }
 
-int32_t range_start_cmp(void *a, void *b){
-    return ((struct cb_hit_expansion *)a)->offset -
-           ((struct cb_hit_expansion *)b)->offset;
+/*Prints how often a cache used while expanding hits had what was asked for.*/
+void print_cache_stats(char *name, uint64_t hits, uint64_t misses){
+    double rate = hits + misses == 0 ? 0 : 100.0 * hits / (hits + misses);
+
+    fprintf(stderr, "\n\n%s: %lu hits, %lu misses (%.1f%% hit rate)",
+            name, hits, misses, rate);
 }
 
 int
 main(int argc, char **argv)
 {
     int i = 0, j = 0;
-    uint64_t dbsize = 0, expanded_dbsize = 0;
+    uint64_t dbsize = 0, expanded_dbsize = 0, decoded_size = 0;
     struct cb_database *db = NULL;
     struct opt_config *conf;
     struct opt_args *args;
     xmlDoc *doc = NULL;
     xmlNode *root = NULL;
-    struct DSVector *iterations = NULL, *expanded_hits = NULL,
-                    *queries = NULL, *oseqs = ds_vector_create();
-    struct DSHashMap *range_trees = ds_hashmap_create();
+    struct DSVector *iterations = NULL, *windows = NULL, *queries = NULL;
+    struct cb_expansion_window *merged = NULL;
+    struct cb_hit_expansion **expansions = NULL;
+    int64_t num_merged = 0;
     struct fasta_seq *query = NULL;
     FILE *query_file = NULL;
     char *blast_args = NULL;
@@ -354,7 +456,13 @@ main(int argc, char **argv)
     blast_args = get_blast_args(args);
     has_evalue = has_blast_arg(args, "-evalue");
 
-    db = cb_database_read(args->args[0], search_flags.map_seed_size);
+    db = cb_database_read(args->args[0]);
+    if (search_flags.coarse_cache_size > 0)
+        db->coarse_db->cache = cb_coarse_cache_init(
+            (int64_t)search_flags.coarse_cache_size * 1024 * 1024);
+    if (search_flags.compressed_cache_size > 0)
+        db->com_db->cache = cb_compressed_cache_init(
+            (int64_t)search_flags.compressed_cache_size * 1024 * 1024);
     dbsize = read_int_from_file(8, db->coarse_db->file_params);
     blast_coarse(args, dbsize);
     query_file = fopen(args->args[1], "r");
@@ -382,32 +490,36 @@ main(int argc, char **argv)
     if (!search_flags.hide_messages)
         fprintf(stderr, "Expanding coarse BLAST hits\n");
 
-    /*Expand any BLAST hits we got from the current query sequence during
-      coarse BLAST.*/
-    for (i = 0; i < iterations->size; i++) {
-        /*If the show-progress flag is activated, display the progress bar*/
-        if (!search_flags.hide_messages) {
-            char *bar = progress_bar(i, iterations->size);
-            fprintf(stderr, "\r");
-            fprintf(stderr, "iteration: %d/%d", i+1, iterations->size);
-            fprintf(stderr, " %s", bar);
-            free(bar);
-        }
-
-        expanded_hits = expand_blast_hits(iterations, i, db, range_trees);
-        query = (struct fasta_seq *)ds_vector_get(queries, i);
-        for (j = 0; j < expanded_hits->size; j++) {
-            struct cb_hit_expansion *current_expansion =
-                (struct cb_hit_expansion *)ds_vector_get(expanded_hits, j);
-            expanded_dbsize += current_expansion->seq->length;
-            ds_vector_append(oseqs, (void *)current_expansion);
-        }
-        ds_vector_free_no_data(expanded_hits);
+    /*Find the windows of original sequences that the BLAST hits we got from
+      every query sequence during coarse BLAST expand to, merge the windows
+      that overlap, and decode each merged window once.*/
+    windows = get_expansion_windows(iterations, db);
+    for (j = 0; j < windows->size; j++) {
+        struct cb_expansion_window *window =
+            (struct cb_expansion_window *)ds_vector_get(windows, j);
+        expanded_dbsize += window->end - window->start;
     }
-
+    merged = cb_merge_windows(windows, &num_merged);
+    for (j = 0; j < num_merged; j++)
+        decoded_size += merged[j].end - merged[j].start;
+    if (!search_flags.hide_messages)
+        fprintf(stderr, "\n\nExpansion windows: %d windows of %lu residues "
+                        "merged into %ld windows of %lu residues "
+                        "(%.1f%% redundant)",
+                windows->size, expanded_dbsize, num_merged, decoded_size,
+                expanded_dbsize == 0 ? 0 :
+                100.0 * (expanded_dbsize - decoded_size) / expanded_dbsize);
+    expansions = expand_windows(db, merged, num_merged, search_flags.procs);
+
+    if (!search_flags.hide_messages && db->coarse_db->cache != NULL)
+        print_cache_stats("Coarse sequence cache", db->coarse_db->cache->hits,
+                          db->coarse_db->cache->misses);
+    if (!search_flags.hide_messages && db->com_db->cache != NULL)
+        print_cache_stats("Compressed sequence cache",
+                          db->com_db->cache->hits, db->com_db->cache->misses);
     if (!search_flags.hide_messages)
         fprintf(stderr, "\n\nWriting database for fine BLAST\n\n");
-    write_fine_db(range_trees);
+    write_fine_db(expansions, num_merged);
     blast_fine(args->args[1], expanded_dbsize, blast_args, has_evalue);
     free(blast_args);
 
@@ -424,14 +536,12 @@ main(int argc, char **argv)
         }
     }
 
-    for (i = 0; i < oseqs->size; i++)
-        cb_hit_expansion_free(
-            (struct cb_hit_expansion *)ds_vector_get(oseqs, i));
-
-    ds_vector_free_no_data(oseqs);
-    for (i = 0; i < range_trees->keys->size; i++)
-        cb_range_tree_free((struct cb_range_tree *)ds_geti(range_trees,i));
-    ds_hashmap_free(range_trees, false, true);
+    for (j = 0; j < num_merged; j++)
+        if (expansions[j] != NULL)
+            cb_hit_expansion_free(expansions[j]);
+    free(expansions);
+    free(merged);
+    ds_vector_free(windows);
 
     cb_database_free(db);
     xmlFreeDoc(doc);
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,14 +9,24 @@
 #include "DNAutils.h"
 #include "fasta.h"
 #include "seeds.h"
+#include "seeds_file.h"
 #include "seq.h"
+#include "writer.h"
+
+static struct DSVector *
+read_v1_coarse_links(FILE *f);
+
+static struct DSVector *
+read_v2_coarse_links(FILE *f);
 
 /*Takes in the size of the k-mers that will be used in compression and file
-  pointers for the database and returns a newly-created coarse database.*/
+  pointers for the database and returns a newly-created coarse database.  No
+  seeds table is made if seed_size is 0.*/
 struct cb_coarse *
 cb_coarse_init(int32_t seed_size,
                 FILE *file_fasta, FILE *file_seeds, FILE *file_links,
                 FILE *file_links_index, FILE *file_fasta_index,
+                FILE *file_packed, FILE *file_packed_index,
                 FILE *file_params)
 {
     struct cb_coarse *coarse_db;
@@ -25,7 +36,7 @@ cb_coarse_init(int32_t seed_size,
     assert(coarse_db);
 
     coarse_db->seqs = ds_vector_create_capacity(10000000);
-    coarse_db->seeds = cb_seeds_init(seed_size);
+    coarse_db->seeds = seed_size > 0 ? cb_seeds_init(seed_size) : NULL;
     coarse_db->dbsize = (uint64_t)0;
 
     /*Initialize the file pointers*/
@@ -34,12 +45,28 @@ cb_coarse_init(int32_t seed_size,
     coarse_db->file_links = file_links;
     coarse_db->file_fasta_index = file_fasta_index;
     coarse_db->file_links_index = file_links_index;
+    coarse_db->file_packed = file_packed;
+    coarse_db->file_packed_index = file_packed_index;
     coarse_db->file_params = file_params;
+    coarse_db->map_links_index = NULL;
+    coarse_db->map_fasta_index = NULL;
+    coarse_db->links_file = NULL;
+    coarse_db->packed = NULL;
+    coarse_db->seeds_file = NULL;
+    coarse_db->cache = NULL;
 
     if (0 != (errno = pthread_rwlock_init(&coarse_db->lock_seq, NULL))) {
         fprintf(stderr, "Could not create rwlock. Errno: %d\n", errno);
         exit(1);
     }
+    if (0 != (errno = pthread_mutex_init(&coarse_db->lock_fasta, NULL))) {
+        fprintf(stderr, "Could not create mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+    if (0 != (errno = pthread_mutex_init(&coarse_db->lock_links, NULL))) {
+        fprintf(stderr, "Could not create mutex. Errno: %d\n", errno);
+        exit(1);
+    }
 
     return coarse_db;
 }
@@ -52,29 +79,75 @@ cb_coarse_free(struct cb_coarse *coarse_db)
     int32_t errno;
     int32_t i;
 
+    cb_mapped_index_free(coarse_db->map_links_index);
+    cb_mapped_index_free(coarse_db->map_fasta_index);
+    cb_links_file_free(coarse_db->links_file);
+    cb_packed_seqs_free(coarse_db->packed);
+    cb_seeds_file_free(coarse_db->seeds_file);
+    cb_coarse_cache_free(coarse_db->cache);
     fclose(coarse_db->file_fasta);
     fclose(coarse_db->file_seeds);
     fclose(coarse_db->file_links);
     fclose(coarse_db->file_links_index);
     fclose(coarse_db->file_fasta_index);
+    if (coarse_db->file_packed != NULL)
+        fclose(coarse_db->file_packed);
+    if (coarse_db->file_packed_index != NULL)
+        fclose(coarse_db->file_packed_index);
     fclose(coarse_db->file_params);
 
     if (0 != (errno = pthread_rwlock_destroy(&coarse_db->lock_seq))) {
         fprintf(stderr, "Could not destroy rwlock. Errno: %d\n", errno);
         exit(1);
     }
+    if (0 != (errno = pthread_mutex_destroy(&coarse_db->lock_fasta))) {
+        fprintf(stderr, "Could not destroy mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+    if (0 != (errno = pthread_mutex_destroy(&coarse_db->lock_links))) {
+        fprintf(stderr, "Could not destroy mutex. Errno: %d\n", errno);
+        exit(1);
+    }
     for (i = 0; i < coarse_db->seqs->size; i++)
         cb_coarse_seq_free(
             (struct cb_coarse_seq *) ds_vector_get(coarse_db->seqs, i));
 
     ds_vector_free_no_data(coarse_db->seqs);
-    cb_seeds_free(coarse_db->seeds);
+    if (coarse_db->seeds != NULL)
+        cb_seeds_free(coarse_db->seeds);
     free(coarse_db);
 }
 
+/*Maps coarse.links, the coarse.links and coarse.fasta indexes and the packed
+ *residues of a coarse database into memory so that looking up a coarse
+ *sequence does not need any I/O.  This must only be called on a database that
+ *has been opened for reading.  Files that cannot be mapped are still read
+ *through their file pointers.
+ */
+void
+cb_coarse_map_indexes(struct cb_coarse *coarse_db)
+{
+    coarse_db->map_links_index =
+        cb_mapped_index_init(coarse_db->file_links_index);
+    coarse_db->map_fasta_index =
+        cb_mapped_index_init(coarse_db->file_fasta_index);
+    coarse_db->links_file = cb_links_file_init(coarse_db->file_links);
+    coarse_db->packed = cb_packed_seqs_init(coarse_db->file_packed,
+                                            coarse_db->file_packed_index);
+}
+
+/*Maps the coarse.seeds file of a coarse database that was opened for reading
+  so that k-mers can be looked up in it with cb_seeds_file_lookup.*/
+void
+cb_coarse_map_seeds(struct cb_coarse *coarse_db)
+{
+    coarse_db->seeds_file = cb_seeds_file_init(coarse_db->file_seeds);
+}
+
 struct cb_coarse_seq *
 cb_coarse_add(struct cb_coarse *coarse_db,
-               char *residues, int32_t start, int32_t end)
+               char *residues, int32_t start, int32_t end,
+               int32_t dust_window, int32_t dust_level)
 {
     struct cb_coarse_seq *seq;
     int32_t id;
@@ -85,7 +158,7 @@ cb_coarse_add(struct cb_coarse *coarse_db,
     ds_vector_append(coarse_db->seqs, (void*) seq);
     pthread_rwlock_unlock(&coarse_db->lock_seq);
 
-    cb_seeds_add(coarse_db->seeds, seq);
+    cb_seeds_add(coarse_db->seeds, seq, dust_window, dust_level);
 
     return seq;
 }
@@ -102,105 +175,55 @@ cb_coarse_get(struct cb_coarse *coarse_db, int32_t i)
     return seq;
 }
 
-/*Outputs the sequences in the coarse database to a FASTA file in plain text,
- *outputs the links to the compressed database in a binary format, and outputs
- *the size of the database to the params file.
+/*Outputs the sequences in the coarse database to a FASTA file in plain text
+ *for makeblastdb and to the packed residue file for decompression, outputs
+ *the links to the compressed database in a binary format, and outputs the size
+ *of the database to the params file.
  */
 void
 cb_coarse_save_binary(struct cb_coarse *coarse_db)
 {
     struct cb_coarse_seq *seq;
-    struct cb_link_to_compressed *link;
+    struct cb_writer *fasta, *fasta_index, *links, *links_index,
+                     *packed, *packed_index;
+    char header[32];
     int64_t i;
-    int j;
 
-    /*Keeps track of the index to be printed to coarse.links.index*/
-    uint64_t index = (uint64_t)0;
-    
-    int16_t mask = (((int16_t)1)<<8)-1;
+    fasta = cb_writer_init(coarse_db->file_fasta);
+    fasta_index = cb_writer_init(coarse_db->file_fasta_index);
+    links = cb_writer_init(coarse_db->file_links);
+    links_index = cb_writer_init(coarse_db->file_links_index);
+    packed = cb_writer_init(coarse_db->file_packed);
+    packed_index = cb_writer_init(coarse_db->file_packed_index);
 
     for (i = 0; i < coarse_db->seqs->size; i++) {
-        uint64_t coarse_fasta_loc;
-        char *fasta_output, *link_header;
-
-        fasta_output = malloc(30000*sizeof(*fasta_output));
-        assert(fasta_output);
-        link_header = malloc(30*sizeof(*fasta_output));
-        assert(link_header);
-
         seq = (struct cb_coarse_seq *) ds_vector_get(coarse_db->seqs, i);
 
         /*At the start of outputting each sequence, output the indices for the
           coarse links and FASTA files to their index files.*/
-        output_int_to_file(index, 8, coarse_db->file_links_index);
-        coarse_fasta_loc = ftell(coarse_db->file_fasta);
-        output_int_to_file(coarse_fasta_loc, 8, coarse_db->file_fasta_index);
+        cb_writer_int(links_index, (uint64_t)cb_writer_tell(links), 8);
+        cb_writer_int(fasta_index, (uint64_t)cb_writer_tell(fasta), 8);
 
         /*Output the FASTA sequence to the coarse FASTA file*/
-        sprintf(fasta_output, "> %ld\n%s\n", i, seq->seq->residues);
-        for(j = 0; fasta_output[j] != '\0'; j++)
-            putc(fasta_output[j], coarse_db->file_fasta);
-
-        /*Output the link header for the sequence to the coarse links file*/
-        sprintf(link_header, "> %ld\n", i);
-        for(j = 0; link_header[j] != '\0'; j++)
-            putc(link_header[j], coarse_db->file_links);
-
-        /*For each character outputted to the coarse links file, increment
-          "index"*/
-        index += strlen(link_header);
-
-        free(fasta_output);
-        free(link_header);
+        sprintf(header, "> %ld\n", i);
+        cb_writer_string(fasta, header);
+        cb_writer_bytes(fasta, seq->seq->residues, seq->seq->length);
+        cb_writer_char(fasta, '\n');
+        cb_packed_seqs_write(packed, packed_index,
+                             seq->seq->residues, seq->seq->length);
 
         /*Output all links for the current sequence to the coarse links file*/
-        for (link = seq->links; link != NULL; link = link->next) {
-            int j;
-            char *id_bytes = read_int_to_bytes(link->org_seq_id, 8);
-            int16_t coarse_start, coarse_end;
-            char coarse_start_left, coarse_start_right,
-                 coarse_end_left, coarse_end_right;
-            for (j = 0; j < 8; j++)
-                putc(id_bytes[j], coarse_db->file_links);
-
-            /*Convert the start and end indices for the link to two
-              characters.*/
-            coarse_start = (int16_t)link->coarse_start;
-            coarse_end   = (int16_t)link->coarse_end;
-            coarse_start_left  = (coarse_start >> 8) & mask;
-            coarse_start_right = coarse_start & mask;
-            coarse_end_left    = (coarse_end >> 8) & mask;
-            coarse_end_right   = coarse_end & mask;
-
-            /*Prints the binary representations of the indices and the
-              direction of the link to the links file*/
-            putc(coarse_start_left, coarse_db->file_links);
-            putc(coarse_start_right, coarse_db->file_links);
-            putc(coarse_end_left, coarse_db->file_links);
-            putc(coarse_end_right, coarse_db->file_links);
-            output_int_to_file(link->original_start, 8, coarse_db->file_links);
-            output_int_to_file(link->original_end, 8, coarse_db->file_links);
-            putc((link->dir?'0':'1'), coarse_db->file_links);
-
-            index += 29;
-
-            /*0 is used as a delimiter to signify that there are more links
-              for this sequence*/
-            if (link->next != NULL) {
-                putc(0, coarse_db->file_links);
-                index++;
-            }
-        }
-
-        /*'#' is used as a delimiter to signify the last link of the sequence*/
-        if (i+1 < coarse_db->seqs->size){
-            putc('#', coarse_db->file_links);
-            index++;
-        }
+        cb_links_file_write(seq->links, links);
     }
+
+    cb_writer_free(fasta);
+    cb_writer_free(fasta_index);
+    cb_writer_free(links);
+    cb_writer_free(links_index);
+    cb_writer_free(packed);
+    cb_writer_free(packed_index);
     output_int_to_file(coarse_db->dbsize, 8, coarse_db->file_params);
     putc('\n', coarse_db->file_params);
-    putc('\n', coarse_db->file_links);
 }
 
 void
@@ -224,32 +247,12 @@ cb_coarse_save_plain(struct cb_coarse *coarse_db)
     }
 }
 
+/*Outputs the seeds table to the coarse.seeds file in the format described in
+  seeds_file.h, using "threads" threads.*/
 void
-cb_coarse_save_seeds_binary(struct cb_coarse *coarse_db)
+cb_coarse_save_seeds_binary(struct cb_coarse *coarse_db, int32_t threads)
 {
-    int32_t i;
-    char *kmer;
-
-    for (i = 0; i < coarse_db->seeds->locs_length; i++) {
-        struct cb_seed_loc *loc;
-        kmer = unhash_kmer(coarse_db->seeds, i);
-        loc = cb_seeds_lookup(coarse_db->seeds, kmer);
-        if (loc) {
-            struct cb_seed_loc *loc_first;
-            output_int_to_file(i, 4, coarse_db->file_seeds);    
-            loc_first = loc;
-            while (loc) {
-                output_int_to_file(loc->coarse_seq_id,4,coarse_db->file_seeds);
-                output_int_to_file(loc->residue_index,2,coarse_db->file_seeds);
-                loc = loc->next;
-                if (loc) putc((char)0, coarse_db->file_seeds);
-            }
-            putc((char)1, coarse_db->file_seeds);
-            cb_seed_loc_free(loc_first);
-        }
-        free(kmer);
-    }
-    putc('\n', coarse_db->file_seeds);
+    cb_seeds_file_write(coarse_db->seeds, coarse_db->file_seeds, threads);
 }
 
 void
@@ -346,8 +349,8 @@ cb_coarse_seq_addlink(struct cb_coarse_seq *seq,
 }
 
 struct cb_link_to_compressed *
-cb_link_to_compressed_init(int32_t org_seq_id, int16_t coarse_start,
-                            int16_t coarse_end, uint64_t original_start,
+cb_link_to_compressed_init(int32_t org_seq_id, int32_t coarse_start,
+                            int32_t coarse_end, uint64_t original_start,
                             uint64_t original_end, bool dir)
 {
     struct cb_link_to_compressed *link;
@@ -372,8 +375,8 @@ cb_link_to_compressed_free(struct cb_link_to_compressed *link)
     free(link);
 }
 
-/*A function for getting the header for an entry in the coarse links file.
-  Returns NULL if EOF is found before a newline.*/
+/*A function for getting the header for an entry in a coarse links file in
+  version 1 of the format.  Returns NULL if EOF is found before a newline.*/
 char *get_coarse_header(FILE *f){
     int c = 0;
     int header_length = 30, i = 0;
@@ -402,8 +405,9 @@ char *get_coarse_header(FILE *f){
     return header;
 }
 
-/*Reads one link from a file with the links to the compressed database and
-  converts its data to a struct cb_link_to_compressed*/
+/*Reads one link from a file with the links to the compressed database in
+  version 1 of the format and converts its data to a struct
+  cb_link_to_compressed*/
 struct cb_link_to_compressed *read_coarse_link(FILE *f){
     struct cb_link_to_compressed *link = malloc(sizeof(*link));
     assert(link);
@@ -445,30 +449,13 @@ struct cb_link_to_compressed *read_coarse_link(FILE *f){
 
 /*Takes in a pointer to the coarse.links file generated by cablast-compress and
  *returns a vector containing all of the links in the coarse database entry for
- *the sequence the file pointer currently points to.  For this function to work
- *properly the file pointer must be pointing to the start of the header of a
- *sequence entry in the links file.
+ *the sequence the file pointer currently points to, in order of coarse start.
+ *For this function to work properly the file pointer must be pointing to the
+ *start of a sequence entry in the links file.  Returns NULL at the end of the
+ *file.
  */
 struct DSVector *get_coarse_sequence_links(FILE *f){
-    struct DSVector *links = ds_vector_create();
-    char *h = get_coarse_header(f);
-    if (h == NULL) {
-        ds_vector_free(links);
-        return NULL;
-    }
-    free(h);
-
-    while (true) {
-        char c = 1;
-        struct cb_link_to_compressed *current_link = read_coarse_link(f);
-        if (current_link == NULL)
-            break;
-        ds_vector_append(links, (void *)current_link);
-        c = getc(f);
-        if (c == '#')
-            break;
-    }
-    return links;
+    return cb_links_file_read(f);
 }
 
 /*A wrapper function for get_coarse_sequence_links that handles fseek calls;
@@ -513,20 +500,250 @@ int64_t cb_coarse_find_offset(FILE *index_file, int id){
     return offset;
 }
 
+/*Takes in as arguments a coarse database and the ID number of a coarse
+ *sequence and returns the links to the compressed database for that sequence,
+ *using the mapped coarse.links index if there is one.
+ */
+struct DSVector *cb_coarse_read_links(struct cb_coarse *coarsedb, int id){
+    return cb_coarse_read_links_range(coarsedb, id, 0, INT32_MAX);
+}
+
+/*Takes in as arguments a coarse database, the ID number of a coarse sequence
+ *and a range of it, from "from" to "to" inclusive, and returns the links to
+ *the compressed database for that sequence that overlap the range, in order
+ *of coarse start.  If coarse.links is mapped, they are found with its interval
+ *tree without reading the other links; otherwise all of the links are read
+ *and filtered.  More than one thread can call this at once.
+ */
+struct DSVector *cb_coarse_read_links_range(struct cb_coarse *coarsedb, int id,
+                                            int32_t from, int32_t to){
+    struct DSVector *links = NULL, *overlapping;
+    struct cb_link_to_compressed *link;
+    int64_t offset;
+    int32_t i;
+
+    if (coarsedb->map_links_index != NULL && coarsedb->links_file != NULL) {
+        offset = cb_mapped_index_get(coarsedb->map_links_index, id);
+        if (offset < 0)
+            return NULL;
+        return cb_links_file_overlapping(coarsedb->links_file, offset,
+                                         from, to);
+    }
+
+    pthread_mutex_lock(&coarsedb->lock_links);
+    if (coarsedb->map_links_index == NULL)
+        links = get_coarse_sequence_links_at(coarsedb->file_links,
+                                             coarsedb->file_links_index, id);
+    else {
+        offset = cb_mapped_index_get(coarsedb->map_links_index, id);
+        if (offset >= 0 && fseek(coarsedb->file_links, offset, SEEK_SET) == 0)
+            links = get_coarse_sequence_links(coarsedb->file_links);
+        else if (offset >= 0)
+            fprintf(stderr, "Error in seeking to offset %ld\n", offset);
+    }
+    pthread_mutex_unlock(&coarsedb->lock_links);
+    if (links == NULL)
+        return NULL;
+
+    overlapping = ds_vector_create();
+    for (i = 0; i < links->size; i++) {
+        link = (struct cb_link_to_compressed *)ds_vector_get(links, i);
+        if (link->coarse_start <= to && link->coarse_end >= from)
+            ds_vector_append(overlapping, (void *)link);
+        else
+            cb_link_to_compressed_free(link);
+    }
+    ds_vector_free_no_data(links);
+    return overlapping;
+}
+
 /*Takes in as arguments a coarse database and the ID number of the sequence in
  *the coarse FASTA file to read in and gets a struct fasta_seq for that
- *sequence.
+ *sequence.  More than one thread can call this at once.
  */
 struct fasta_seq *cb_coarse_read_fasta_seq(struct cb_coarse *coarsedb,
                                                                int id){
-    bool fseek_success;
-    int64_t offset = cb_coarse_find_offset(coarsedb->file_fasta_index, id);
-    if (offset < 0)
+    struct fasta_seq *seq = NULL;
+    int64_t offset;
+
+    pthread_mutex_lock(&coarsedb->lock_fasta);
+    offset = coarsedb->map_fasta_index != NULL ?
+        cb_mapped_index_get(coarsedb->map_fasta_index, id) :
+        cb_coarse_find_offset(coarsedb->file_fasta_index, id);
+    if (offset >= 0) {
+        if (fseek(coarsedb->file_fasta, offset, SEEK_SET) == 0)
+            seq = fasta_read_next(coarsedb->file_fasta, "");
+        else
+            fprintf(stderr, "Error in seeking to offset %ld\n", offset);
+    }
+    pthread_mutex_unlock(&coarsedb->lock_fasta);
+    return seq;
+}
+
+/*Takes in as arguments a coarse database, the ID number of a coarse sequence
+ *and a range in the sequence and returns a new string with the residues from
+ *start up to but not including end.  The residues come from the coarse
+ *sequence cache if the database has one, and are otherwise read straight from
+ *the packed residue file if the database has one.  Sequences that are read
+ *from the coarse FASTA file, or that are going into the cache, are read
+ *whole.  Returns NULL if there is no such sequence.
+ */
+char *cb_coarse_read_residues(struct cb_coarse *coarsedb, int id,
+                              int start, int end){
+    struct fasta_seq *seq;
+    char *whole, *residues;
+    int length;
+
+    if (coarsedb->cache != NULL) {
+        residues = cb_coarse_cache_get(coarsedb->cache, id, start, end);
+        if (residues != NULL)
+            return residues;
+    }
+    else if (coarsedb->packed != NULL)
+        return cb_packed_seqs_get(coarsedb->packed, id, start, end);
+
+    if (coarsedb->packed != NULL) {
+        if ((length = cb_packed_seqs_length(coarsedb->packed, id)) < 0)
+            return NULL;
+        whole = cb_packed_seqs_get(coarsedb->packed, id, 0, length);
+    }
+    else {
+        if (NULL == (seq = cb_coarse_read_fasta_seq(coarsedb, id)))
+            return NULL;
+        whole = seq->seq;
+        seq->seq = NULL;
+        fasta_free_seq(seq);
+        length = strlen(whole);
+    }
+
+    if (start < 0)
+        start = 0;
+    if (end > length)
+        end = length;
+    if (end < start)
+        end = start;
+
+    residues = malloc((end - start + 1)*sizeof(*residues));
+    assert(residues);
+    memcpy(residues, whole + start, end - start);
+    residues[end-start] = '\0';
+
+    if (coarsedb->cache != NULL)
+        cb_coarse_cache_add(coarsedb->cache, id, whole, length);
+    else
+        free(whole);
+    return residues;
+}
+
+/*Copies a coarse.links file from "in" to "out" in the current version of the
+ *format and writes the index of the new file to out_index.  "in" can be in
+ *any version of the format.  Returns the number of coarse sequences copied.
+ */
+int32_t cb_coarse_links_convert(FILE *in, FILE *out, FILE *out_index){
+    struct DSVector *links;
+    struct cb_link_to_compressed *first, *link;
+    struct cb_writer *w, *w_index;
+    int32_t num_seqs = 0;
+    int version, i;
+
+    version = read_format_header(CABLAST_COARSE_LINKS_MAGIC, in);
+    output_format_header(CABLAST_COARSE_LINKS_MAGIC,
+                         CABLAST_COARSE_LINKS_VERSION, out);
+
+    w = cb_writer_init(out);
+    w_index = cb_writer_init(out_index);
+
+    while (NULL != (links = version == 1 ? read_v1_coarse_links(in) :
+                            version == 2 ? read_v2_coarse_links(in) :
+                                           get_coarse_sequence_links(in))) {
+        first = NULL;
+        for (i = links->size - 1; i >= 0; i--) {
+            link = (struct cb_link_to_compressed *)ds_vector_get(links, i);
+            link->next = first;
+            first = link;
+        }
+        cb_writer_int(w_index, (uint64_t)cb_writer_tell(w), 8);
+        cb_links_file_write(first, w);
+        ds_vector_free(links);
+        num_seqs++;
+    }
+    cb_writer_free(w);
+    cb_writer_free(w_index);
+    return num_seqs;
+}
+
+/*Reads the links of a coarse sequence from a coarse.links file in version 1
+ *of the format, in which every coarse sequence starts with a "> <ID>" header
+ *line and is followed by its links separated by 0 bytes, with a '#' between
+ *coarse sequences.  Returns NULL at the end of the file.
+ */
+static struct DSVector *
+read_v1_coarse_links(FILE *f){
+    struct DSVector *links;
+    struct cb_link_to_compressed *current_link;
+    char *h = get_coarse_header(f);
+
+    if (h == NULL)
         return NULL;
-    fseek_success = fseek(coarsedb->file_fasta, offset, SEEK_SET) == 0;
-    if (!fseek_success) {
-        fprintf(stderr, "Error in seeking to offset %ld\n", offset);
+    free(h);
+
+    links = ds_vector_create();
+    while (NULL != (current_link = read_coarse_link(f))) {
+        ds_vector_append(links, (void *)current_link);
+        if (getc(f) == '#')
+            break;
+    }
+    return links;
+}
+
+/*Reads the links of a coarse sequence from a coarse.links file in version 2
+ *of the format, in which each coarse sequence is a varint with the number of
+ *bytes in the rest of the record, followed by a varint with the number of
+ *links.  Each link is then stored as varints with the difference of its
+ *original sequence ID from that of the previous link (zigzag-encoded), its
+ *coarse start, its coarse end minus its coarse start shifted left by one with
+ *the direction of the link in the lowest bit, its original start and its
+ *original end minus its original start.  Returns NULL at the end of the file.
+ */
+static struct DSVector *
+read_v2_coarse_links(FILE *f){
+    struct DSVector *links;
+    struct cb_link_to_compressed *link;
+    int32_t length, num_links, i, span;
+    int32_t org_seq_id = 0;
+    char *record;
+    int pos = 0;
+
+    length = (int32_t)read_varint_from_file(f);
+    if (feof(f) || length == 0)
+        return NULL;
+
+    record = malloc(length*sizeof(*record));
+    assert(record);
+    if (fread(record, sizeof(*record), length, f) != (size_t)length) {
+        free(record);
         return NULL;
     }
-    return fasta_read_next(coarsedb->file_fasta, "");
+
+    links = ds_vector_create();
+    num_links = (int32_t)get_varint(record, &pos);
+    for (i = 0; i < num_links; i++) {
+        link = malloc(sizeof(*link));
+        assert(link);
+
+        org_seq_id += unzigzag(get_varint(record, &pos));
+        link->org_seq_id = org_seq_id;
+        link->coarse_start = (int32_t)get_varint(record, &pos);
+        span = (int32_t)get_varint(record, &pos);
+        link->dir = span & 1;
+        link->coarse_end = link->coarse_start + (span >> 1);
+        link->original_start = get_varint(record, &pos);
+        link->original_end = link->original_start + get_varint(record, &pos);
+        link->next = NULL;
+
+        ds_vector_append(links, (void *)link);
+    }
+
+    free(record);
+    return links;
 }
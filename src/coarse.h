@@ -10,14 +10,25 @@
 
 #include "ds.h"
 
+#include "coarse_cache.h"
 #include "link_to_compressed.h"
+#include "links_file.h"
+#include "mapped_index.h"
+#include "packed_seqs.h"
 #include "seeds.h"
+#include "seeds_file.h"
 #include "seq.h"
 #include "stdbool.h"
 
+/*coarse.links starts with this magic string followed by a byte with the
+  version of the file's format.  Files without it are in version 1.  The
+  current format is described in links_file.h.*/
+#define CABLAST_COARSE_LINKS_MAGIC "CBLASTL"
+#define CABLAST_COARSE_LINKS_VERSION 3
+
 struct cb_link_to_compressed *
-cb_link_to_compressed_init(int32_t org_seq_id, int16_t coarse_start,
-                            int16_t coarse_end, uint64_t original_start,
+cb_link_to_compressed_init(int32_t org_seq_id, int32_t coarse_start,
+                            int32_t coarse_end, uint64_t original_start,
                             uint64_t original_end, bool dir);
 
 void
@@ -42,6 +53,9 @@ cb_coarse_seq_addlink(struct cb_coarse_seq *seq,
 
 struct cb_coarse {
     struct DSVector *seqs;
+
+    /*The seeds table being built, or NULL if the database was opened for
+      reading.*/
     struct cb_seeds *seeds;
     uint64_t dbsize;
     FILE *file_fasta;
@@ -49,14 +63,45 @@ struct cb_coarse {
     FILE *file_links;
     FILE *file_links_index;
     FILE *file_fasta_index;
+    FILE *file_packed;
+    FILE *file_packed_index;
     FILE *file_params;
+
+    /*Read-only maps of file_links_index and file_fasta_index, or NULL if the
+      indexes are being written or could not be mapped.*/
+    struct cb_mapped_index *map_links_index;
+    struct cb_mapped_index *map_fasta_index;
+
+    /*A read-only map of file_links, or NULL if the links are being written or
+      could not be mapped.*/
+    struct cb_links_file *links_file;
+
+    /*A read-only map of file_packed, or NULL if the database has no packed
+      residues (it is older, or being written).*/
+    struct cb_packed_seqs *packed;
+
+    /*A read-only map of file_seeds, or NULL if the seeds are being written or
+      the file could not be mapped.*/
+    struct cb_seeds_file *seeds_file;
+
+    /*Recently read coarse sequences, or NULL if they are not cached.*/
+    struct cb_coarse_cache *cache;
+
     pthread_rwlock_t lock_seq;
+
+    /*Held while a sequence is read from file_fasta, so that more than one
+      thread can read coarse residues at once.*/
+    pthread_mutex_t lock_fasta;
+
+    /*Held while links are read from file_links when it is not mapped.*/
+    pthread_mutex_t lock_links;
 };
 
 struct cb_coarse *
 cb_coarse_init(int32_t seed_size,
                 FILE *file_fasta, FILE *file_seeds, FILE *file_links,
                 FILE *file_links_index, FILE *file_fasta_index,
+                FILE *file_packed, FILE *file_packed_index,
                 FILE *file_params);
 
 void
@@ -64,11 +109,18 @@ cb_coarse_free(struct cb_coarse *coarse_db);
 
 struct cb_coarse_seq *
 cb_coarse_add(struct cb_coarse *coarse_db,
-               char *residues, int32_t start, int32_t end);
+               char *residues, int32_t start, int32_t end,
+               int32_t dust_window, int32_t dust_level);
 
 struct cb_coarse_seq *
 cb_coarse_get(struct cb_coarse *coarse_db, int32_t i);
 
+void
+cb_coarse_map_indexes(struct cb_coarse *coarse_db);
+
+void
+cb_coarse_map_seeds(struct cb_coarse *coarse_db);
+
 void
 cb_coarse_save_binary(struct cb_coarse *coarse_db);
 
@@ -76,7 +128,7 @@ void
 cb_coarse_save_plain(struct cb_coarse *coarse_db);
 
 void
-cb_coarse_save_seeds_binary(struct cb_coarse *coarse_db);
+cb_coarse_save_seeds_binary(struct cb_coarse *coarse_db, int32_t threads);
 
 void
 cb_coarse_save_seeds_plain(struct cb_coarse *coarse_db);
@@ -88,7 +140,13 @@ struct DSVector *get_coarse_sequence_links(FILE *f);
 struct DSVector *get_coarse_sequence_links_at(FILE *links, FILE *index,
                                                            int32_t id);
 int64_t cb_coarse_find_offset(FILE *index_file, int id);
+struct DSVector *cb_coarse_read_links(struct cb_coarse *coarsedb, int id);
+struct DSVector *cb_coarse_read_links_range(struct cb_coarse *coarsedb, int id,
+                                            int32_t from, int32_t to);
+int32_t cb_coarse_links_convert(FILE *in, FILE *out, FILE *out_index);
 struct fasta_seq *cb_coarse_read_fasta_seq(struct cb_coarse *coarsedb,
                                             int id);
+char *cb_coarse_read_residues(struct cb_coarse *coarsedb, int id,
+                              int start, int end);
 
 #endif
@@ -0,0 +1,122 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coarse_cache.h"
+
+static void
+free_entry(struct cb_lru_entry *entry);
+
+/*Creates an empty cache that holds at most "capacity" residues.*/
+struct cb_coarse_cache *
+cb_coarse_cache_init(int64_t capacity)
+{
+    struct cb_coarse_cache *cache;
+    int32_t errno;
+
+    cache = malloc(sizeof(*cache));
+    assert(cache);
+
+    cache->entries = cb_lru_init(capacity, free_entry);
+    cache->hits = 0;
+    cache->misses = 0;
+
+    if (0 != (errno = pthread_mutex_init(&cache->lock, NULL))) {
+        fprintf(stderr, "Could not create mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+
+    return cache;
+}
+
+void
+cb_coarse_cache_free(struct cb_coarse_cache *cache)
+{
+    int32_t errno;
+
+    if (cache == NULL)
+        return;
+
+    if (0 != (errno = pthread_mutex_destroy(&cache->lock))) {
+        fprintf(stderr, "Could not destroy mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+    cb_lru_free(cache->entries);
+    free(cache);
+}
+
+/*Returns a new string with the residues from start up to but not including
+ *end of the cached coarse sequence with the ID passed into id, and marks the
+ *sequence as the most recently used.  The range is clipped to the end of the
+ *sequence.  Returns NULL if the sequence is not in the cache.
+ */
+char *
+cb_coarse_cache_get(struct cb_coarse_cache *cache, int32_t id,
+                    int32_t start, int32_t end)
+{
+    struct cb_coarse_cache_entry *entry;
+    char *residues = NULL;
+
+    pthread_mutex_lock(&cache->lock);
+    entry = (struct cb_coarse_cache_entry *)cb_lru_get(cache->entries, id);
+    if (entry != NULL) {
+        cache->hits++;
+
+        if (start < 0)
+            start = 0;
+        if (end > entry->length)
+            end = entry->length;
+        if (end < start)
+            end = start;
+
+        residues = malloc((end - start + 1)*sizeof(*residues));
+        assert(residues);
+        memcpy(residues, entry->residues + start, end - start);
+        residues[end-start] = '\0';
+    }
+    else
+        cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    return residues;
+}
+
+/*Adds the residues of a coarse sequence to the cache, which takes ownership
+ *of them, and evicts the least recently used sequences until the cache is
+ *back under its capacity.  Sequences longer than the capacity of the cache
+ *and sequences that another thread has already added are freed right away.
+ */
+void
+cb_coarse_cache_add(struct cb_coarse_cache *cache, int32_t id,
+                    char *residues, int32_t length)
+{
+    struct cb_coarse_cache_entry *entry;
+    bool added;
+
+    if (length > cache->entries->capacity) {
+        free(residues);
+        return;
+    }
+
+    entry = malloc(sizeof(*entry));
+    assert(entry);
+    entry->lru.id = id;
+    entry->lru.size = length;
+    entry->residues = residues;
+    entry->length = length;
+
+    pthread_mutex_lock(&cache->lock);
+    added = cb_lru_add(cache->entries, &entry->lru);
+    pthread_mutex_unlock(&cache->lock);
+
+    if (!added)
+        free_entry(&entry->lru);
+}
+
+static void
+free_entry(struct cb_lru_entry *entry)
+{
+    free(((struct cb_coarse_cache_entry *)entry)->residues);
+    free(entry);
+}
@@ -0,0 +1,39 @@
+#ifndef __CABLAST_COARSE_CACHE_H__
+#define __CABLAST_COARSE_CACHE_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "lru.h"
+
+/*A coarse sequence held in the cache, whose size is its length.*/
+struct cb_coarse_cache_entry {
+    struct cb_lru_entry lru;
+    char *residues;
+    int32_t length;
+};
+
+/*A least recently used cache of the residues of whole coarse sequences.  The
+  total number of residues cached never goes over the capacity of "entries".*/
+struct cb_coarse_cache {
+    struct cb_lru *entries;
+    uint64_t hits;
+    uint64_t misses;
+    pthread_mutex_t lock;
+};
+
+struct cb_coarse_cache *
+cb_coarse_cache_init(int64_t capacity);
+
+void
+cb_coarse_cache_free(struct cb_coarse_cache *cache);
+
+char *
+cb_coarse_cache_get(struct cb_coarse_cache *cache, int32_t id,
+                    int32_t start, int32_t end);
+
+void
+cb_coarse_cache_add(struct cb_coarse_cache *cache, int32_t id,
+                    char *residues, int32_t length);
+
+#endif
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "ds.h"
 
@@ -8,17 +9,91 @@
 #include "compressed.h"
 #include "edit_scripts.h"
 
+static void
+open_writers(struct cb_compressed *com_db);
+
+static void
+write_pending(struct cb_compressed *com_db, bool all);
+
+static int
+compare_seq_ids(const void *a, const void *b);
+
+static void
+output_compressed_seq(struct cb_compressed_seq *seq,
+                      int32_t checkpoint_interval, struct cb_writer *f,
+                      struct cb_writer *index, struct cb_writer *lengths);
+
+static char *
+edit_script_bytes(char *edit_script, int32_t checkpoint_interval,
+                  int32_t *length);
+
+static int
+compare_links(const void *a, const void *b);
+
+static void
+put_int(char *buf, uint32_t n);
+
+static struct cb_compressed_seq *
+read_compressed_record(FILE *f, int version, int64_t *original_length);
+
+static struct cb_link_to_coarse *
+decode_link(char *record, int *pos, int32_t *coarse_id,
+            int32_t *original_start);
+
+static struct cb_compressed_seq *
+read_v1_seq(FILE *f);
+
+static void
+use_header_name(struct cb_compressed_seq *seq);
+
+static char *
+read_edit_script_from_file(FILE *f, struct cb_link_checkpoint **checkpoints,
+                           int32_t *num_checkpoints);
+
+static void
+read_checkpoints(char *script, int32_t length,
+                 struct cb_link_checkpoint **checkpoints,
+                 int32_t *num_checkpoints);
+
+static struct cb_compressed_seq *
+read_seq_range(struct cb_compressed *comdb, int32_t id, int64_t start,
+               int64_t end, bool *whole);
+
 struct cb_compressed *
-cb_compressed_init(FILE *file_compressed, FILE *file_index)
+cb_compressed_init(FILE *file_compressed, FILE *file_index,
+                   FILE *file_lengths)
 {
     struct cb_compressed *com_db;
+    int32_t errno;
 
     com_db = malloc(sizeof(*com_db));
     assert(com_db);
 
     com_db->file_compressed = file_compressed;
     com_db->file_index = file_index;
+    com_db->file_lengths = file_lengths;
+    com_db->writer_compressed = NULL;
+    com_db->writer_index = NULL;
+    com_db->writer_lengths = NULL;
+    com_db->pending = NULL;
+    com_db->num_pending = 0;
+    com_db->pending_allocated = 0;
+    com_db->next_write = 0;
+    com_db->map_index = NULL;
+    com_db->seq_lengths = NULL;
+    com_db->num_seq_lengths = 0;
     com_db->seqs = ds_vector_create_capacity(100);
+    com_db->checkpoint_interval = 0;
+    com_db->cache = NULL;
+
+    if (0 != (errno = pthread_mutex_init(&com_db->lock_write, NULL))) {
+        fprintf(stderr, "Could not create mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+    if (0 != (errno = pthread_mutex_init(&com_db->lock_read, NULL))) {
+        fprintf(stderr, "Could not create mutex. Errno: %d\n", errno);
+        exit(1);
+    }
 
     return com_db;
 }
@@ -26,10 +101,33 @@ cb_compressed_init(FILE *file_compressed, FILE *file_index)
 void
 cb_compressed_free(struct cb_compressed *com_db)
 {
+    int32_t errno;
     int i;
 
+    if (0 != (errno = pthread_mutex_destroy(&com_db->lock_write))) {
+        fprintf(stderr, "Could not destroy mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+    if (0 != (errno = pthread_mutex_destroy(&com_db->lock_read))) {
+        fprintf(stderr, "Could not destroy mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+
+    /*Sequences still waiting for one with a smaller ID that never came are
+      written anyway.*/
+    write_pending(com_db, true);
+    free(com_db->pending);
+
+    cb_writer_free(com_db->writer_compressed);
+    cb_writer_free(com_db->writer_index);
+    cb_writer_free(com_db->writer_lengths);
+    cb_mapped_index_free(com_db->map_index);
+    cb_compressed_cache_free(com_db->cache);
     fclose(com_db->file_compressed);
     fclose(com_db->file_index);
+    if (com_db->file_lengths != NULL)
+        fclose(com_db->file_lengths);
+    free(com_db->seq_lengths);
 
     for (i = 0; i < com_db->seqs->size; i++)
         cb_compressed_seq_free(cb_compressed_seq_at(com_db, i));
@@ -59,115 +157,13 @@ void
 cb_compressed_save_binary(struct cb_compressed *com_db)
 {
     int i;
-    struct cb_compressed_seq *seq;
-    struct cb_link_to_coarse *link;
 
-    int16_t mask = (((int16_t)1)<<8)-1;
-    uint64_t index = (uint64_t)0;
-
-    for (i = 0; i < com_db->seqs->size; i++) {
-        char *id_bytes;
-        int j;
-        uint64_t original_length = 0;
-        struct cb_link_to_coarse *find_length;
-
-        output_int_to_file(index, 8, com_db->file_index);
-        seq = cb_compressed_seq_at(com_db, i);
-        id_bytes = read_int_to_bytes(seq->id, 8);
-
-        putc('>', com_db->file_compressed);
-        putc(' ', com_db->file_compressed);
-        for (j = 0; j < 8; j++)
-            putc(id_bytes[j], com_db->file_compressed);
-        putc(';', com_db->file_compressed);
-        putc(' ', com_db->file_compressed);
-
-        index += 12;
-
-        for(j = 0; seq->name[j] != '\0'; j++)
-            putc(seq->name[j], com_db->file_compressed);
-        index += j;
-        putc('\n', com_db->file_compressed);
-        index++;
-
-        find_length = seq->links;
-        original_length = 0;
-        for (; find_length; find_length = find_length->next)
-            original_length = find_length->original_end + 1;
-
-        output_int_to_file(original_length, 8, com_db->file_compressed);
-
-        for (link = seq->links; link != NULL; link = link->next){
-            /*Convert the start and end indices for the link to two
-              characters.*/
-            uint64_t org_start = link->original_start;
-            uint64_t org_end   = link->original_end;
-            int16_t cor_start = (int16_t)link->coarse_start;
-            int16_t cor_end   = (int16_t)link->coarse_end;
-            char cor_start_left  = (cor_start >> 8) & mask;
-            char cor_start_right = cor_start & mask;
-            char cor_end_left    = (cor_end >> 8) & mask;
-            char cor_end_right   = cor_end & mask;
-
-            char script_left, script_right;
-            char *edit_script = link->diff;
-            char *script;
-            int16_t script_length = (int16_t)0;
-            int j;
-
-            /*Output the ID of the current chunk as 8 characters*/
-            int coarse_seq_id = link->coarse_seq_id;
-            for (j = 7; j >= 0; j--) {
-                char b = shift_right(coarse_seq_id, j*8) & mask;
-                putc(b, com_db->file_compressed);
-            }
-            index += 8;
-
-            /*Represent the length of the edit script as two characters and get
-              the edit script as a sequence of half-bytes*/
-            while (edit_script[script_length] != '\0')
-                script_length++;
-
-            script_left  = (script_length >> 8) & mask;
-            script_right = script_length & mask;
-            script = edit_script_to_half_bytes(edit_script);
-
-            /*Output the indices of the start and end of the sequence being
-             *linked to and the length of the edit script represented in 16
-             *bits, and the length of the edit script.
-             */
-            output_int_to_file(org_start, 8, com_db->file_compressed);
-            output_int_to_file(org_end, 8, com_db->file_compressed);
-            putc(cor_start_left, com_db->file_compressed);
-            putc(cor_start_right, com_db->file_compressed);
-            putc(cor_end_left, com_db->file_compressed);
-            putc(cor_end_right, com_db->file_compressed);
-            putc(script_left, com_db->file_compressed);
-            putc(script_right, com_db->file_compressed);
-            index += 6;
-
-            /*Output all of the characters of the edit script as half-bytes*/
-            for (j = 0; j < script_length/2; j++)
-                putc(script[j], com_db->file_compressed);
-            index += j;
-
-
-            /*If there are more links for this sequence, the character after
-             *the edit script is a space.  Otherwise, the character after the
-             *edit script is the > of the FASTA header.  If we are printing the
-             *last link of the last sequence, print a newline.
-             */
-            if (link->next) {
-                putc(' ', com_db->file_compressed);
-                index++;
-            }
-            else
-                if (i == com_db->seqs->size-1) {
-                    putc('\n', com_db->file_compressed);
-                    index++;
-                }
-        }
-    }
+    open_writers(com_db);
+    for (i = 0; i < com_db->seqs->size; i++)
+        output_compressed_seq(cb_compressed_seq_at(com_db, i),
+                              com_db->checkpoint_interval,
+                              com_db->writer_compressed, com_db->writer_index,
+                              com_db->writer_lengths);
 }
 
 void
@@ -180,13 +176,16 @@ cb_compressed_save_plain(struct cb_compressed *com_db)
     for (i = 0; i < com_db->seqs->size; i++) {
         seq = cb_compressed_seq_at(com_db, i);
         fprintf(com_db->file_compressed, "> %ld; %s\n", seq->id, seq->name);
-        for (link = seq->links; link != NULL; link = link->next)
+        for (link = seq->links; link != NULL; link = link->next) {
+            char *diff = edit_script_to_ASCII(link->diff);
             fprintf(com_db->file_compressed,
                 "reference sequence id: %d, reference range: (%d, %d), "
                   "original sequence range: (%ld %ld)\n%s\n",
                 link->coarse_seq_id, link->coarse_start, link->coarse_end,
                 link->original_start, link->original_end,
-                link->diff);
+                diff);
+            free(diff);
+        }
     }
 }
 
@@ -198,112 +197,84 @@ cb_compressed_write(struct cb_compressed *com_db,
 
     fprintf(com_db->file_compressed, "> %ld; %s\n", seq->id, seq->name);
     for (link = seq->links; link != NULL; link = link->next) {
+        char *diff = edit_script_to_ASCII(link->diff);
         fprintf(com_db->file_compressed,
             "reference sequence id: %d, reference range: (%d, %d)\n%s\n",
             link->coarse_seq_id, link->coarse_start, link->coarse_end,
-            link->diff);
+            diff);
+        free(diff);
     }
 }
 
 /*Outputs a compressed sequence in the compressed database to the database's
-  compressed file in binary format.*/
+ *compressed file in binary format and frees it.  Sequences are written in the
+ *order of their IDs, so that the index can be used to find a sequence by its
+ *ID however many threads compress: a sequence that comes before all of the
+ *sequences with smaller IDs waits until they have been written.
+ */
 void
 cb_compressed_write_binary(struct cb_compressed *com_db,
                             struct cb_compressed_seq *seq)
 {
-    int i;
-    struct cb_link_to_coarse *link;
-    int16_t mask = (((int16_t)1)<<8)-1;
-    char *id_string;
-    uint64_t index = ftell(com_db->file_compressed), original_length = 0;
-    struct cb_link_to_coarse *find_length;
-
-    id_string = malloc(20*sizeof(*id_string));
-    assert(id_string);
-
-    output_int_to_file(index, 8, com_db->file_index);
-    sprintf(id_string, "%ld", seq->id);
-
-    /*Output the header for the sequence*/
-    putc('>', com_db->file_compressed);
-    putc(' ', com_db->file_compressed);
-    for (i = 0; id_string[i] != '\0'; i++)
-        putc(id_string[i], com_db->file_compressed);
-    putc(';', com_db->file_compressed);
-    putc(' ', com_db->file_compressed);
-    for (i = 0; seq->name[i] != '\0'; i++)
-        putc(seq->name[i], com_db->file_compressed);
-    putc('\n', com_db->file_compressed);
-
-    free(id_string);
-
-    find_length = seq->links;
-    for (; find_length; find_length = find_length->next)
-        original_length = find_length->original_end + 1;
-
-    output_int_to_file(original_length, 8, com_db->file_compressed);
-
-    for (link = seq->links; link != NULL; link = link->next){
-        /*Convert the start and end indices for the link to two
-          characters.*/
-        uint64_t org_start = link->original_start;
-        uint64_t org_end   = link->original_end;
-        int16_t cor_start = (int16_t)link->coarse_start;
-        int16_t cor_end   = (int16_t)link->coarse_end;
-        char cor_start_left  = (cor_start >> 8) & mask;
-        char cor_start_right = cor_start & mask;
-        char cor_end_left    = (cor_end >> 8) & mask;
-        char cor_end_right   = cor_end & mask;
-
-        char script_left, script_right;
-        char *edit_script = link->diff;
-        char *script = edit_script_to_half_bytes(edit_script);
-        int16_t script_length = (int16_t)0;
-        int odd;
-
-        /*Output the ID of the current chunk as 8 characters*/
-        uint64_t coarse_seq_id = link->coarse_seq_id;
-        for (i = 7; i >= 0; i--) {
-            char b = (char)(shift_right(coarse_seq_id, i*8) & mask);
-            putc(b, com_db->file_compressed);
+    pthread_mutex_lock(&com_db->lock_write);
+    open_writers(com_db);
+    if (com_db->num_pending == com_db->pending_allocated) {
+        com_db->pending_allocated = com_db->pending_allocated == 0 ?
+                                    16 : 2 * com_db->pending_allocated;
+        com_db->pending = realloc(com_db->pending, com_db->pending_allocated*
+                                                   sizeof(*com_db->pending));
+        assert(com_db->pending);
+    }
+    com_db->pending[com_db->num_pending++] = seq;
+    write_pending(com_db, false);
+    pthread_mutex_unlock(&com_db->lock_write);
+}
+
+/*Writes and frees the waiting sequences of com_db that are next in order of
+  ID, or all of them in order of ID if "all" is true.*/
+static void
+write_pending(struct cb_compressed *com_db, bool all)
+{
+    struct cb_compressed_seq *seq;
+    int32_t i = 0;
+
+    if (all)
+        qsort(com_db->pending, com_db->num_pending, sizeof(*com_db->pending),
+              compare_seq_ids);
+    while (i < com_db->num_pending) {
+        seq = com_db->pending[i];
+        if (!all && (int64_t)seq->id > com_db->next_write) {
+            i++;
+            continue;
         }
+        output_compressed_seq(seq, com_db->checkpoint_interval,
+                              com_db->writer_compressed, com_db->writer_index,
+                              com_db->writer_lengths);
+        if ((int64_t)seq->id >= com_db->next_write)
+            com_db->next_write = seq->id + 1;
+        cb_compressed_seq_free(seq);
+
+        if (all)
+            i++;
+        else {
+            com_db->pending[i] = com_db->pending[--com_db->num_pending];
+            i = 0;
+        }
+    }
+    if (all)
+        com_db->num_pending = 0;
+}
+
+/*Orders compressed sequences by their IDs.*/
+static int
+compare_seq_ids(const void *a, const void *b)
+{
+    const struct cb_compressed_seq *x = *(struct cb_compressed_seq **)a;
+    const struct cb_compressed_seq *y = *(struct cb_compressed_seq **)b;
 
-        /*Represent the length of the edit script as two characters and get
-          the edit script as a sequence of half-bytes*/
-        while (edit_script[script_length] != '\0')
-            script_length++;
-        odd = script_length % 2 == 1 ? 1 : 0;
-        script_left  = (script_length >> 8) & mask;
-        script_right = script_length & mask;
-
-        /*Output the indices of the start and end of the sequence being
-         *linked to and the length of the edit script represented in 16
-         *bits, and the length of the edit script.
-         */
-        output_int_to_file(org_start, 8, com_db->file_compressed);
-        output_int_to_file(org_end, 8, com_db->file_compressed);
-        putc(cor_start_left, com_db->file_compressed);
-        putc(cor_start_right, com_db->file_compressed);
-        putc(cor_end_left, com_db->file_compressed);
-        putc(cor_end_right, com_db->file_compressed);
-        putc(script_left, com_db->file_compressed);
-        putc(script_right, com_db->file_compressed);
-
-        /*Output all of the characters of the edit script as half-bytes*/
-        for (i = 0; i < script_length/2+odd; i++)
-            putc(script[i], com_db->file_compressed);
-
-        /*If there are more links for this sequence, the character after
-         *the edit script is a space.  Otherwise, the character after the
-         *edit script is the > of the FASTA header.  If we are printing the
-         *last link of the last sequence, print a newline.
-         */
-        if (link->next)
-            putc(' ', com_db->file_compressed);
-
-        free(script);
-    }
-    putc('\n', com_db->file_compressed);
+    if (x->id != y->id)
+        return x->id < y->id ? -1 : 1;
+    return 0;
 }
 
 struct cb_compressed_seq *
@@ -359,7 +330,7 @@ cb_compressed_seq_addlink(struct cb_compressed_seq *seq,
 struct cb_link_to_coarse *
 cb_link_to_coarse_init(int32_t coarse_seq_id,
                         uint64_t original_start, uint64_t original_end,
-                        uint16_t coarse_start, uint16_t coarse_end,
+                        uint32_t coarse_start, uint32_t coarse_end,
                         struct cb_alignment alignment, bool dir){
     struct cb_link_to_coarse *link;
 
@@ -371,6 +342,8 @@ cb_link_to_coarse_init(int32_t coarse_seq_id,
     link->original_end = original_end;
     link->coarse_start = coarse_start;
     link->coarse_end = coarse_end;
+    link->checkpoints = NULL;
+    link->num_checkpoints = 0;
     link->next = NULL;
     link->diff = make_edit_script(alignment.org, alignment.ref, dir,
                                                    alignment.length);
@@ -382,7 +355,7 @@ cb_link_to_coarse_init(int32_t coarse_seq_id,
 struct cb_link_to_coarse *
 cb_link_to_coarse_init_nodiff(int32_t coarse_seq_id,
                                uint64_t original_start, uint64_t original_end,
-                               uint16_t coarse_start, uint16_t coarse_end,
+                               uint32_t coarse_start, uint32_t coarse_end,
                                bool dir){
     struct cb_link_to_coarse *link;
 
@@ -399,6 +372,8 @@ cb_link_to_coarse_init_nodiff(int32_t coarse_seq_id,
     link->original_end = original_end;
     link->coarse_start = coarse_start;
     link->coarse_end = coarse_end;
+    link->checkpoints = NULL;
+    link->num_checkpoints = 0;
     link->next = NULL;
 
     return link;
@@ -408,6 +383,7 @@ void
 cb_link_to_coarse_free(struct cb_link_to_coarse *link)
 {
     free(link->diff);
+    free(link->checkpoints);
     free(link);
 }
 
@@ -417,8 +393,9 @@ cb_compressed_seq_at(struct cb_compressed *com_db, int32_t i)
     return (struct cb_compressed_seq *) ds_vector_get(com_db->seqs, i);
 }
 
-/*A function for getting the header for an entry in the compressed links file.
-  Returns NULL if EOF is found before a newline.*/
+/*A function for getting the header for an entry in a compressed links file
+  in version 1 of the format.  Returns NULL if EOF is found before a
+  newline.*/
 char *get_compressed_header(FILE *f){
     int c = 0;
     char *header;
@@ -452,16 +429,10 @@ char *get_compressed_header(FILE *f){
     return header;
 }
 
-/*Reads one link from a file with the links to the coarse database and converts
-  its data to a struct cb_link_to_coarse*/
+/*Reads one link from a file with the links to the coarse database in version 1
+  of the format and converts its data to a struct cb_link_to_coarse*/
 struct cb_link_to_coarse *read_compressed_link(FILE *f){
-    int i;
-    unsigned int c = 0;
-    uint16_t script_length = (uint16_t)0;
     struct cb_link_to_coarse *link;
-    int chars_to_read;
-    char *half_bytes;
-    char *diff;
 
     link = malloc(sizeof(*link));
     assert(link);
@@ -496,64 +467,33 @@ struct cb_link_to_coarse *read_compressed_link(FILE *f){
         return NULL;
     }
 
-    script_length = (uint16_t)read_int_from_file(2, f);
-
-    chars_to_read = script_length / 2;
-    if (script_length % 2 == 1)
-        chars_to_read++;
-    half_bytes = malloc(chars_to_read*sizeof(*half_bytes));
-    assert(half_bytes);
-
-    for (i = 0; i < chars_to_read; i++) {
-        c = getc(f);
-        if (feof(f)) {
-            free(link);
-            return NULL;
-        }
-        half_bytes[i] = (char)c;
+    link->diff = read_edit_script_from_file(f, &link->checkpoints,
+                                            &link->num_checkpoints);
+    if (link->diff == NULL) {
+        free(link);
+        return NULL;
     }
-    diff = half_bytes_to_ASCII(half_bytes, script_length);
-    free(half_bytes);
-    link->diff = diff;
     link->next = NULL;
     return link;
 }
 
-/*Takes in a pointer to the coarse.links file generated by cablast-compress and
- *the ID number of the sequence and returns the compressed sequence that the
- *data being read represents.  For this function to work properly the file
- *pointer must be pointing to the start of the header of a sequence entry in the
- *links file.
+/*Takes in a pointer to the compressed.cb file generated by cablast-compress
+ *and the ID number of the sequence and returns the compressed sequence that
+ *the data being read represents.  Its name is the header of the sequence,
+ *"<original ID>; <name>".  For this function to work properly the file
+ *pointer must be pointing to the start of a sequence entry in the file.
  */
 struct cb_compressed_seq *get_compressed_seq(FILE *f, int id){
-    char *h = get_compressed_header(f);
-    struct cb_link_to_coarse *first_link = NULL;
-    struct cb_link_to_coarse *last_link = NULL;
-    struct cb_compressed_seq *seq = cb_compressed_seq_init(id, h);
+    int64_t original_length;
+    struct cb_compressed_seq *seq =
+        read_compressed_record(f, CABLAST_COMPRESSED_VERSION, &original_length);
 
-    if (h == NULL) {
+    if (seq == NULL) {
         fprintf(stderr, "Could not get compressed sequence\n");
         return NULL;
     }
-    free(h);
-
-    read_int_from_file(8, f);
-
-    while (true) {
-        char c = 1;
-        struct cb_link_to_coarse *current_link = read_compressed_link(f);
-        if (current_link == NULL)
-            break;
-        if (!first_link)
-            first_link = current_link;
-        else
-            last_link->next = current_link;
-        last_link = current_link;
-        c = getc(f);
-        if (c == '\n')
-            break;
-    }
-    seq->links = first_link;
+    use_header_name(seq);
+    seq->id = id;
     return seq;
 }
 
@@ -580,6 +520,155 @@ struct cb_compressed_seq *cb_compressed_read_seq_at(
     return get_compressed_seq(links, id);
 }
 
+/*Reads the sequence with the index passed into id like
+ *cb_compressed_read_seq_at, but with only the links that overlap the
+ *original residues from start up to but not including end.  The block table
+ *of the sequence is searched for the first block with a link that ends at or
+ *after start, and blocks are read from there until one has a link that starts
+ *at or after end, so only the part of the record around the range is read.
+ *
+ *If comdb has a cache, the range is copied out of the cached sequence when
+ *there is one.  Otherwise records that are small next to the cache are read
+ *whole and added to it, so that later ranges of the same sequence are not
+ *read again.  More than one thread can call this at once.
+ */
+struct cb_compressed_seq *cb_compressed_read_seq_range(
+                                                 struct cb_compressed *comdb,
+                                                 int32_t id, int64_t start,
+                                                 int64_t end){
+    struct cb_compressed_seq *seq;
+    bool whole = false;
+
+    if (comdb->cache != NULL &&
+          NULL != (seq = cb_compressed_cache_get(comdb->cache, id, start, end)))
+        return seq;
+
+    pthread_mutex_lock(&comdb->lock_read);
+    seq = read_seq_range(comdb, id, start, end, &whole);
+    pthread_mutex_unlock(&comdb->lock_read);
+
+    if (whole)
+        return cb_compressed_cache_add(comdb->cache, seq, start, end);
+    return seq;
+}
+
+/*Reads a range of a sequence from file_compressed for
+  cb_compressed_read_seq_range, setting *whole if the whole sequence was read
+  to be cached.*/
+static struct cb_compressed_seq *
+read_seq_range(struct cb_compressed *comdb, int32_t id, int64_t start,
+               int64_t end, bool *whole)
+{
+    FILE *f = comdb->file_compressed;
+    struct cb_compressed_seq *seq;
+    struct cb_link_to_coarse *link, *last = NULL;
+    int64_t offset = cb_compressed_link_offset(comdb, id), record_end;
+    int32_t original_id, name_length, num_links, num_blocks, block, lo, hi,
+            mid, size, i;
+    int32_t coarse_id, original_start;
+    char *name, *bytes;
+    unsigned char *table;
+    bool done = false;
+    int pos;
+
+    if (offset < 0 || fseek(f, offset, SEEK_SET) != 0) {
+        fprintf(stderr, "Error in seeking to offset %ld\n", offset);
+        return NULL;
+    }
+    record_end = (int64_t)read_varint_from_file(f);
+    if (feof(f) || record_end == 0)
+        return NULL;
+
+    if (comdb->cache != NULL &&
+          record_end <= comdb->cache->entries->capacity /
+                        CABLAST_COMPRESSED_CACHE_MIN_RECORDS) {
+        seq = cb_compressed_read_seq_at(comdb, id);
+        *whole = seq != NULL;
+        return seq;
+    }
+    record_end += ftell(f);
+
+    original_id = (int32_t)read_varint_from_file(f);
+    name_length = (int32_t)read_varint_from_file(f);
+    name = malloc((name_length + 1)*sizeof(*name));
+    assert(name);
+    if (fread(name, sizeof(*name), name_length, f) != (size_t)name_length) {
+        free(name);
+        return NULL;
+    }
+    name[name_length] = '\0';
+    seq = cb_compressed_seq_init(original_id, name);
+    use_header_name(seq);
+    seq->id = id;
+    free(name);
+
+    read_varint_from_file(f);
+    num_links = (int32_t)read_varint_from_file(f);
+    num_blocks = (int32_t)read_varint_from_file(f);
+    table = malloc((8*num_blocks + 1)*sizeof(*table));
+    assert(table);
+    if (fread(table, 8, num_blocks, f) != (size_t)num_blocks) {
+        free(table);
+        cb_compressed_seq_free(seq);
+        return NULL;
+    }
+    record_end -= ftell(f);
+
+    /*The greatest ends in the table never go down, so the first block that
+      can overlap the range is the first one whose greatest end is at least
+      start.*/
+    lo = 0;
+    hi = num_blocks;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if ((int64_t)read_int_from_bytes(table + 8*mid + 4, 4) < start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < num_blocks &&
+          fseek(f, (long)read_int_from_bytes(table + 8*lo, 4), SEEK_CUR) != 0)
+        lo = num_blocks;
+
+    for (block = lo; !done && block < num_blocks; block++) {
+        if (block + 1 < num_blocks)
+            size = (int32_t)read_int_from_bytes(table + 8*(block+1), 4);
+        else
+            size = (int32_t)record_end;
+        size -= (int32_t)read_int_from_bytes(table + 8*block, 4);
+        bytes = malloc(size*sizeof(*bytes));
+        assert(bytes);
+        if (fread(bytes, sizeof(*bytes), size, f) != (size_t)size) {
+            free(bytes);
+            break;
+        }
+
+        pos = 0;
+        coarse_id = original_start = 0;
+        for (i = block * CABLAST_COMPRESSED_LINK_BLOCK;
+             i < num_links && i < (block+1) * CABLAST_COMPRESSED_LINK_BLOCK;
+             i++) {
+            link = decode_link(bytes, &pos, &coarse_id, &original_start);
+            if ((int64_t)link->original_start >= end)
+                done = true;
+            if ((int64_t)link->original_end < start ||
+                  (int64_t)link->original_start >= end) {
+                cb_link_to_coarse_free(link);
+                continue;
+            }
+            if (last == NULL)
+                seq->links = link;
+            else
+                last->next = link;
+            last = link;
+        }
+        free(bytes);
+    }
+
+    free(table);
+    return seq;
+}
+
 /*Takes in a file pointer to a compressed database's compressed.cb file and
  *returns the length of the original sequence that was compressed to produce
  *the sequence that the file pointer is pointing to.  For this function to work
@@ -587,53 +676,137 @@ struct cb_compressed_seq *cb_compressed_read_seq_at(
  *compressed.cb file.
  */
 int64_t cb_compressed_get_seq_length(FILE *f){
-    char *h = get_compressed_header(f);
-    if (h == NULL) {
+    int64_t original_length;
+    struct cb_compressed_seq *seq =
+        read_compressed_record(f, CABLAST_COMPRESSED_VERSION, &original_length);
+
+    if (seq == NULL) {
         fprintf(stderr, "Could not get sequence length\n");
         return -1;
     }
-    free(h);
-    return read_int_from_file(8, f);
+    cb_compressed_seq_free(seq);
+    return original_length;
+}
+
+/*Returns the number of sequences in the compressed database's index, or -1 if
+  the index cannot be read.*/
+static int64_t
+index_size(struct cb_compressed *comdb)
+{
+    int64_t num_sequences;
+
+    if (comdb->map_index != NULL)
+        return comdb->map_index->size;
+
+    if (fseek(comdb->file_index, 0, SEEK_END) != 0) {
+        fprintf(stderr, "Error in seeking to end of compressed.cb.index\n");
+        return -1;
+    }
+    num_sequences = ftell(comdb->file_index) / 8;
+    if (fseek(comdb->file_index, 0, SEEK_SET) != 0) {
+        fprintf(stderr, "Error in seeking to start of compressed.cb.index\n");
+        return -1;
+    }
+    return num_sequences;
+}
+
+/*Returns the number of sequences in the compressed database, or -1 if its
+  index cannot be read.*/
+int64_t
+cb_compressed_num_seqs(struct cb_compressed *comdb)
+{
+    return index_size(comdb);
 }
 
-/*Gets the lengths in bases for all sequences in the database*/
+/*Returns the FASTA headers of all sequences in the database, read from the
+ *records in compressed.cb in order, and sets *count to the number of them.
+ *This is for making a name index for databases that do not have one.
+ */
+char **cb_compressed_read_headers(struct cb_compressed *comdb,
+                                  int32_t *count){
+    struct cb_compressed_seq *seq;
+    char **headers;
+    int64_t num_sequences = index_size(comdb), offset, original_length;
+    int32_t i;
+
+    *count = 0;
+    if (num_sequences <= 0)
+        return NULL;
+    offset = cb_compressed_link_offset(comdb, 0);
+    if (offset < 0 || fseek(comdb->file_compressed, offset, SEEK_SET) != 0) {
+        fprintf(stderr, "Error in seeking to offset %ld\n", offset);
+        return NULL;
+    }
+
+    headers = malloc(num_sequences*sizeof(*headers));
+    assert(headers);
+    for (i = 0; i < num_sequences; i++) {
+        seq = read_compressed_record(comdb->file_compressed,
+                                     CABLAST_COMPRESSED_VERSION,
+                                     &original_length);
+        if (seq == NULL)
+            break;
+        headers[i] = seq->name;
+        seq->name = NULL;
+        cb_compressed_seq_free(seq);
+    }
+    *count = i;
+    return headers;
+}
+
+/*Gets the lengths in bases for all sequences in the database.  The lengths
+ *are read in one go from compressed.cb.lengths, which cablast-compress writes
+ *alongside compressed.cb.index.  Databases without a complete lengths file
+ *(file_lengths is NULL if there is none) fall back to reading the length at
+ *the start of every sequence in compressed.cb.
+ */
 int64_t *cb_compressed_get_lengths(struct cb_compressed *comdb){
     FILE *links = comdb->file_compressed;
     FILE *index = comdb->file_index;
 
     bool fseek_success;
     int64_t *lengths = NULL;
-    int64_t num_sequences = ftell(index) / 8;
+    int64_t num_sequences = index_size(comdb);
+    unsigned char *bytes;
+    int64_t i;
+    int j;
 
-    fseek_success = fseek(index, 0, SEEK_END) == 0;
-    if (!fseek_success) {
-        fprintf(stderr, "Error in seeking to end of compressed.cb.index\n");
+    if (num_sequences <= 0)
         return NULL;
-    }
 
-    num_sequences = ftell(index) / 8;
-    fseek_success = fseek(index, 0, SEEK_SET) == 0;
-    if (!fseek_success) {
-        fprintf(stderr, "Error in seeking to start of compressed.cb.index\n");
-        return NULL;
+    lengths = malloc(num_sequences*sizeof(*lengths));
+    assert(lengths);
+
+    if (comdb->file_lengths != NULL &&
+          fseek(comdb->file_lengths, 0, SEEK_END) == 0 &&
+          ftell(comdb->file_lengths) == num_sequences * 8 &&
+          fseek(comdb->file_lengths, 0, SEEK_SET) == 0) {
+        bytes = malloc(num_sequences*8*sizeof(*bytes));
+        assert(bytes);
+        if (fread(bytes, 8, num_sequences, comdb->file_lengths) ==
+              (size_t)num_sequences) {
+            for (i = 0; i < num_sequences; i++) {
+                lengths[i] = 0;
+                for (j = 0; j < 8; j++)
+                    lengths[i] = (lengths[i] << 8) | bytes[i*8 + j];
+            }
+            free(bytes);
+            return lengths;
+        }
+        free(bytes);
     }
 
-    if (num_sequences > 0) {
-        int i = 0;
-        lengths = malloc(num_sequences*sizeof(*lengths));
-        assert(lengths);
-        for (i = 0; i < num_sequences; i++) {
-            int64_t offset = cb_compressed_link_offset(comdb, i);
-
-            fseek_success = fseek(links, offset, SEEK_SET) == 0;
-            if (!fseek_success) {
-                fprintf(stderr, "error in seeking to offset %ld\n", offset);
-                free(lengths);
-                return NULL;
-            }
+    for (i = 0; i < num_sequences; i++) {
+        int64_t offset = cb_compressed_link_offset(comdb, i);
 
-            lengths[i] = cb_compressed_get_seq_length(links);
+        fseek_success = fseek(links, offset, SEEK_SET) == 0;
+        if (!fseek_success) {
+            fprintf(stderr, "error in seeking to offset %ld\n", offset);
+            free(lengths);
+            return NULL;
         }
+
+        lengths[i] = cb_compressed_get_seq_length(links);
     }
 
     fseek(links, 0, SEEK_SET);
@@ -641,53 +814,61 @@ int64_t *cb_compressed_get_lengths(struct cb_compressed *comdb){
     return lengths;
 }
 
+/*Maps compressed.cb.index into memory so that cb_compressed_link_offset does
+  not need any I/O.  This must only be called on a database that has been
+  opened for reading.*/
+void cb_compressed_map_index(struct cb_compressed *comdb){
+    comdb->map_index = cb_mapped_index_init(comdb->file_index);
+}
+
+/*Loads the lengths of all sequences in the database into comdb->seq_lengths
+  so that cb_compressed_seq_length never has to touch the disk.*/
+void cb_compressed_load_lengths(struct cb_compressed *comdb){
+    free(comdb->seq_lengths);
+    comdb->seq_lengths = cb_compressed_get_lengths(comdb);
+    comdb->num_seq_lengths =
+        comdb->seq_lengths == NULL ? 0 : (int32_t)index_size(comdb);
+}
+
+/*Returns the length of the original sequence with the index passed into id,
+  or -1 if there is no such sequence.  The lengths must have been loaded with
+  cb_compressed_load_lengths.*/
+int64_t cb_compressed_seq_length(struct cb_compressed *comdb, int32_t id){
+    if (id < 0 || id >= comdb->num_seq_lengths)
+        return -1;
+    return comdb->seq_lengths[id];
+}
 
 /*Takes the compressed.cb generated by cablast-compress and parses it to get
   an array of compressed sequences.*/
 struct cb_compressed_seq **read_compressed(FILE *f){
-    int length = 0;
+    int length = 0, capacity = 1000;
+    int64_t original_length;
+    struct cb_compressed_seq *seq;
     struct cb_compressed_seq **compressed_seqs =
-        malloc(1000*sizeof(*compressed_seqs));
+        malloc(capacity*sizeof(*compressed_seqs));
     assert(compressed_seqs);
 
-    /*Read each sequence*/
-    while (true) {
-        struct cb_link_to_coarse *links = NULL;
-        char *header = get_compressed_header(f);
-
-        if (header == NULL)
-            break;
+    if (read_format_header(CABLAST_COMPRESSED_MAGIC, f) !=
+          CABLAST_COMPRESSED_VERSION) {
+        fprintf(stderr, "compressed.cb was made by an older version of "
+                        "cablast-compress; run cablast-convert on the "
+                        "database first.\n");
+        exit(1);
+    }
 
-        /*Skip over the length of the original sequence*/
-        read_int_from_file(8, f);
-
-        /*Read each link in the sequence*/
-        while (true) {
-            char c = 1;
-            struct cb_link_to_coarse *current_link = read_compressed_link(f);
-            if (current_link == NULL)
-                break;
-            current_link->next = links;
-            if (current_link->next == NULL)
-                links = current_link;
-            else {
-                while (current_link->next->next != NULL)
-                    current_link->next = current_link->next->next;
-                current_link->next->next = current_link;
-                current_link->next = NULL;
-            }
-            c = getc(f);
-            /*If we find a newline at the end of the link we are at the end of
-              the sequence.*/
-            if (c == '\n')
-                break;
+    /*Read each sequence*/
+    while (NULL != (seq = read_compressed_record(f,
+                                                 CABLAST_COMPRESSED_VERSION,
+                                                 &original_length))) {
+        use_header_name(seq);
+        if (length == capacity - 1) {
+            capacity *= 2;
+            compressed_seqs = realloc(compressed_seqs,
+                                      capacity*sizeof(*compressed_seqs));
+            assert(compressed_seqs);
         }
-        compressed_seqs[length] = malloc(sizeof(*(compressed_seqs[length])));
-        assert(compressed_seqs[length]);
-
-        (compressed_seqs[length])->name = header;
-        (compressed_seqs[length]->links) = links;
-        length++;
+        compressed_seqs[length++] = seq;
     }
 
     compressed_seqs = realloc(compressed_seqs,
@@ -699,14 +880,465 @@ struct cb_compressed_seq **read_compressed(FILE *f){
 }
 
 /*Gets the offset in the compressed database's compressed.cb file for the
- *link whose index is passed into id.
+ *link whose index is passed into id.  The offset is read from the mapped index
+ *if there is one, and from compressed.cb.index otherwise.
  */
 int64_t cb_compressed_link_offset(struct cb_compressed *comdb, int id){
     int try_off = id * 8;
-    bool fseek_success = fseek(comdb->file_index, try_off, SEEK_SET) == 0;
+    bool fseek_success;
+
+    if (comdb->map_index != NULL)
+        return cb_mapped_index_get(comdb->map_index, id);
+
+    fseek_success = fseek(comdb->file_index, try_off, SEEK_SET) == 0;
     if (!fseek_success) {
         fprintf(stderr, "Error in seeking to offset %d", try_off);
         return (int64_t)(-1);
     }
     return read_int_from_file(8,comdb->file_index);
 }
+
+/*Copies a compressed.cb file from "in" to "out" in the current version of the
+ *format, rewriting the edit script of every link in the binary edit script
+ *format with checkpoints every checkpoint_interval residues (none if it is 0),
+ *and writes the index of the new file and the lengths of its sequences to
+ *out_index and out_lengths.  "in" can be in any version of the format, so
+ *converting a database twice is harmless.  Returns the number of sequences
+ *copied.
+ */
+int32_t cb_compressed_convert(FILE *in, FILE *out, FILE *out_index,
+                              FILE *out_lengths, int32_t checkpoint_interval){
+    struct cb_compressed_seq *seq;
+    struct cb_writer *w, *w_index, *w_lengths;
+    int64_t original_length;
+    int32_t num_seqs = 0;
+    int version;
+
+    version = read_format_header(CABLAST_COMPRESSED_MAGIC, in);
+    output_format_header(CABLAST_COMPRESSED_MAGIC, CABLAST_COMPRESSED_VERSION,
+                         out);
+
+    w = cb_writer_init(out);
+    w_index = cb_writer_init(out_index);
+    w_lengths = cb_writer_init(out_lengths);
+    while (NULL != (seq = version == 1 ? read_v1_seq(in) :
+                          read_compressed_record(in, version,
+                                                 &original_length))) {
+        output_compressed_seq(seq, checkpoint_interval, w, w_index, w_lengths);
+        cb_compressed_seq_free(seq);
+        num_seqs++;
+    }
+    cb_writer_free(w);
+    cb_writer_free(w_index);
+    cb_writer_free(w_lengths);
+    return num_seqs;
+}
+
+/*Creates the writers for the files of a compressed database the first time
+  it is saved to.*/
+static void
+open_writers(struct cb_compressed *com_db)
+{
+    if (com_db->writer_compressed != NULL)
+        return;
+    com_db->writer_compressed = cb_writer_init(com_db->file_compressed);
+    com_db->writer_index = cb_writer_init(com_db->file_index);
+    com_db->writer_lengths = cb_writer_init(com_db->file_lengths);
+}
+
+/*Outputs a compressed sequence to a compressed.cb file, its offset in the
+ *file to the file's index and the length of the original sequence to the
+ *lengths file.
+ *
+ *Each sequence is a varint with the number of bytes in the rest of the
+ *record, followed by varints with the original ID of the sequence, the length
+ *of its name, the name itself, the length of the original sequence, the
+ *number of links and the number of blocks of links.  The links are sorted by
+ *their original start and split into blocks of CABLAST_COMPRESSED_LINK_BLOCK
+ *links.  Each block has an 8-byte entry in a table after the number of
+ *blocks: the offset of its first link from the end of the table and the
+ *greatest original end of the links in it and the blocks before it, both as
+ *4-byte big-endian integers, so the first block that can overlap a range is
+ *found by binary search.
+ *
+ *Each link is then stored as varints with the differences of its coarse
+ *sequence ID and original start from those of the previous link in its block
+ *(zigzag-encoded, since coarse IDs can go backwards; the first link of a block
+ *is relative to 0), the length of its original range minus 1, its coarse
+ *start, the length of its coarse range minus 1 and the length of its edit
+ *script, followed by the edit script.
+ */
+static void
+output_compressed_seq(struct cb_compressed_seq *seq,
+                      int32_t checkpoint_interval, struct cb_writer *f,
+                      struct cb_writer *index, struct cb_writer *lengths)
+{
+    struct cb_link_to_coarse *link, **links;
+    uint64_t original_length = 0, max_end = 0;
+    int32_t num_links = 0, num_blocks, name_length, size, pos = 0, table,
+            links_start, script_length, i;
+    int32_t last_coarse_id = 0, last_original_start = 0;
+    char **scripts, *record, *entry;
+    int32_t *script_lengths;
+
+    for (link = seq->links; link != NULL; link = link->next)
+        num_links++;
+    num_blocks = (num_links + CABLAST_COMPRESSED_LINK_BLOCK - 1) /
+                 CABLAST_COMPRESSED_LINK_BLOCK;
+    name_length = strlen(seq->name);
+
+    links = malloc(num_links*sizeof(*links));
+    assert(links);
+    for (i = 0, link = seq->links; link != NULL; i++, link = link->next) {
+        links[i] = link;
+        if (link->original_end + 1 > original_length)
+            original_length = link->original_end + 1;
+    }
+    qsort(links, num_links, sizeof(*links), compare_links);
+
+    scripts = malloc(num_links*sizeof(*scripts));
+    assert(scripts);
+    script_lengths = malloc(num_links*sizeof(*script_lengths));
+    assert(script_lengths);
+
+    size = 4*6 + name_length + 8*num_blocks;
+    for (i = 0; i < num_links; i++) {
+        scripts[i] = edit_script_bytes(links[i]->diff, checkpoint_interval,
+                                       &script_lengths[i]);
+        size += 6*5 + script_lengths[i];
+    }
+
+    record = malloc(size*sizeof(*record));
+    assert(record);
+
+    pos = put_varint(record, pos, (uint32_t)seq->id);
+    pos = put_varint(record, pos, (uint32_t)name_length);
+    memcpy(record + pos, seq->name, name_length);
+    pos += name_length;
+    pos = put_varint(record, pos, (uint32_t)original_length);
+    pos = put_varint(record, pos, (uint32_t)num_links);
+    pos = put_varint(record, pos, (uint32_t)num_blocks);
+    table = pos;
+    links_start = pos = table + 8*num_blocks;
+
+    for (i = 0; i < num_links; i++) {
+        link = links[i];
+        entry = record + table + 8*(i / CABLAST_COMPRESSED_LINK_BLOCK);
+        if (i % CABLAST_COMPRESSED_LINK_BLOCK == 0) {
+            put_int(entry, (uint32_t)(pos - links_start));
+            last_coarse_id = 0;
+            last_original_start = 0;
+        }
+        if (link->original_end > max_end)
+            max_end = link->original_end;
+        put_int(entry + 4, (uint32_t)max_end);
+
+        pos = put_varint(record, pos,
+                         zigzag(link->coarse_seq_id - last_coarse_id));
+        pos = put_varint(record, pos,
+                         zigzag((int32_t)link->original_start -
+                                last_original_start));
+        pos = put_varint(record, pos,
+                         (uint32_t)(link->original_end - link->original_start));
+        pos = put_varint(record, pos, link->coarse_start);
+        pos = put_varint(record, pos,
+                         (uint32_t)(link->coarse_end - link->coarse_start));
+        script_length = script_lengths[i];
+        pos = put_varint(record, pos, (uint32_t)script_length);
+        memcpy(record + pos, scripts[i], script_length);
+        pos += script_length;
+
+        last_coarse_id = link->coarse_seq_id;
+        last_original_start = (int32_t)link->original_start;
+        free(scripts[i]);
+    }
+
+    cb_writer_int(index, (uint64_t)cb_writer_tell(f), 8);
+    cb_writer_varint(f, (uint32_t)pos);
+    cb_writer_bytes(f, record, pos);
+    cb_writer_int(lengths, original_length, 8);
+
+    free(record);
+    free(links);
+    free(scripts);
+    free(script_lengths);
+}
+
+/*Returns a new copy of a binary edit script, setting *length to its length.
+ *If checkpoint_interval is positive, the script is followed by a table of
+ *checkpoints for decoding it from the middle (see edit_script_checkpoints),
+ *which is included in the length: a varint with the number of checkpoints,
+ *then four varints per checkpoint holding the differences of its script,
+ *coarse and original positions from the previous checkpoint and the length of
+ *the edit before it.
+ */
+static char *
+edit_script_bytes(char *edit_script, int32_t checkpoint_interval,
+                  int32_t *length)
+{
+    struct cb_link_checkpoint *checkpoints, *cp, prev = {0, 0, 0, 0};
+    int32_t size = edit_script_size(edit_script), num_checkpoints, i;
+    char *bytes;
+
+    checkpoints = edit_script_checkpoints(edit_script, checkpoint_interval,
+                                          &num_checkpoints);
+
+    bytes = malloc((size + 5 + 20*num_checkpoints)*sizeof(*bytes));
+    assert(bytes);
+    memcpy(bytes, edit_script, size);
+
+    if (num_checkpoints > 0) {
+        size = put_varint(bytes, size, (uint32_t)num_checkpoints);
+        for (i = 0; i < num_checkpoints; i++) {
+            cp = &checkpoints[i];
+            size = put_varint(bytes, size, cp->script_pos - prev.script_pos);
+            size = put_varint(bytes, size, cp->coarse_pos - prev.coarse_pos);
+            size = put_varint(bytes, size,
+                              cp->original_pos - prev.original_pos);
+            size = put_varint(bytes, size, cp->last_edit_str_len);
+            prev = *cp;
+        }
+    }
+
+    free(checkpoints);
+    *length = size;
+    return bytes;
+}
+
+/*Orders links by their original start, and links with the same start by
+  their original end.*/
+static int
+compare_links(const void *a, const void *b)
+{
+    const struct cb_link_to_coarse *x = *(struct cb_link_to_coarse **)a;
+    const struct cb_link_to_coarse *y = *(struct cb_link_to_coarse **)b;
+
+    if (x->original_start != y->original_start)
+        return x->original_start < y->original_start ? -1 : 1;
+    if (x->original_end != y->original_end)
+        return x->original_end < y->original_end ? -1 : 1;
+    return 0;
+}
+
+/*Puts n in the 4 bytes at buf as a big-endian integer.*/
+static void
+put_int(char *buf, uint32_t n)
+{
+    int i;
+
+    for (i = 3; i >= 0; i--, n >>= 8)
+        buf[i] = (char)(n & 0xff);
+}
+
+/*Reads a sequence written by output_compressed_seq in the given version of
+ *the format, setting *original_length to the length of the original sequence.
+ *The sequence's name is the name without its ID.  Returns NULL at the end of
+ *the file.
+ */
+static struct cb_compressed_seq *
+read_compressed_record(FILE *f, int version, int64_t *original_length)
+{
+    struct cb_compressed_seq *seq;
+    struct cb_link_to_coarse *link, *last = NULL;
+    int32_t length, id, name_length, num_links, num_blocks = 0, i;
+    int32_t coarse_id = 0, original_start = 0;
+    char *record, *name;
+    int pos = 0;
+
+    length = (int32_t)read_varint_from_file(f);
+    if (feof(f) || length == 0)
+        return NULL;
+
+    record = malloc(length*sizeof(*record));
+    assert(record);
+    if (fread(record, sizeof(*record), length, f) != (size_t)length) {
+        free(record);
+        return NULL;
+    }
+
+    id = (int32_t)get_varint(record, &pos);
+    name_length = (int32_t)get_varint(record, &pos);
+    name = malloc((name_length + 1)*sizeof(*name));
+    assert(name);
+    memcpy(name, record + pos, name_length);
+    name[name_length] = '\0';
+    pos += name_length;
+
+    seq = cb_compressed_seq_init(id, name);
+    free(name);
+
+    *original_length = get_varint(record, &pos);
+    num_links = (int32_t)get_varint(record, &pos);
+    if (version >= 3) {
+        num_blocks = (int32_t)get_varint(record, &pos);
+        pos += 8*num_blocks;
+    }
+
+    for (i = 0; i < num_links; i++) {
+        /*Deltas start over at every block.*/
+        if (num_blocks > 0 && i % CABLAST_COMPRESSED_LINK_BLOCK == 0)
+            coarse_id = original_start = 0;
+        link = decode_link(record, &pos, &coarse_id, &original_start);
+
+        if (last == NULL)
+            seq->links = link;
+        else
+            last->next = link;
+        last = link;
+    }
+
+    free(record);
+    return seq;
+}
+
+/*Decodes the link at *pos in a record of compressed.cb and moves *pos past
+  it.  *coarse_id and *original_start hold those of the link before it in its
+  block and are set to those of the new link.*/
+static struct cb_link_to_coarse *
+decode_link(char *record, int *pos, int32_t *coarse_id,
+            int32_t *original_start)
+{
+    struct cb_link_to_coarse *link;
+    int32_t script_length;
+
+    link = malloc(sizeof(*link));
+    assert(link);
+
+    *coarse_id += unzigzag(get_varint(record, pos));
+    *original_start += unzigzag(get_varint(record, pos));
+    link->coarse_seq_id = *coarse_id;
+    link->original_start = *original_start;
+    link->original_end = *original_start + get_varint(record, pos);
+    link->coarse_start = get_varint(record, pos);
+    link->coarse_end = link->coarse_start + get_varint(record, pos);
+
+    script_length = (int32_t)get_varint(record, pos);
+    link->diff = malloc(script_length*sizeof(*link->diff));
+    assert(link->diff);
+    memcpy(link->diff, record + *pos, script_length);
+    *pos += script_length;
+    read_checkpoints(link->diff, script_length,
+                     &link->checkpoints, &link->num_checkpoints);
+    link->next = NULL;
+    return link;
+}
+
+/*Reads a sequence from a compressed.cb file in version 1 of the format, in
+ *which every sequence starts with a "> <ID>; <name>" header line and the
+ *length of the original sequence in 8 bytes, followed by its links separated
+ *by spaces and a newline.  Returns NULL at the end of the file.
+ */
+static struct cb_compressed_seq *
+read_v1_seq(FILE *f)
+{
+    struct cb_compressed_seq *seq;
+    struct cb_link_to_coarse *link, *last = NULL;
+    char *header, *name;
+    long id;
+
+    if (NULL == (header = get_compressed_header(f)))
+        return NULL;
+
+    id = strtol(header, &name, 10);
+    if (name != header && name[0] == ';' && name[1] == ' ')
+        seq = cb_compressed_seq_init(id, name + 2);
+    else
+        seq = cb_compressed_seq_init(0, header);
+    free(header);
+
+    read_int_from_file(8, f);
+
+    while (NULL != (link = read_compressed_link(f))) {
+        if (last == NULL)
+            seq->links = link;
+        else
+            last->next = link;
+        last = link;
+        if (getc(f) != ' ')
+            break;
+    }
+    return seq;
+}
+
+/*Sets the name of a sequence read by read_compressed_record to the header it
+  is shown with, "<original ID>; <name>".*/
+static void
+use_header_name(struct cb_compressed_seq *seq)
+{
+    char *name;
+
+    name = malloc((strlen(seq->name) + 24)*sizeof(*name));
+    assert(name);
+    sprintf(name, "%ld; %s", seq->id, seq->name);
+    free(seq->name);
+    seq->name = name;
+}
+
+/*Reads an edit script from a compressed.cb file in version 1 of the format,
+ *which stores the number of characters in an ASCII edit script in 16 bits
+ *followed by the script packed into half-bytes, and returns it converted to a
+ *binary edit script.  Scripts in version 1 have no checkpoints, so the
+ *checkpoint table is always left empty.  Returns NULL at the end of the file.
+ */
+static char *
+read_edit_script_from_file(FILE *f, struct cb_link_checkpoint **checkpoints,
+                           int32_t *num_checkpoints)
+{
+    uint16_t script_length;
+    char *half_bytes, *ascii, *script;
+    int c, bytes, i;
+
+    *checkpoints = NULL;
+    *num_checkpoints = 0;
+
+    script_length = (uint16_t)read_int_from_file(2, f);
+    if (feof(f) || script_length == 0)
+        return NULL;
+
+    bytes = script_length / 2 + script_length % 2;
+    half_bytes = malloc(bytes*sizeof(*half_bytes));
+    assert(half_bytes);
+    for (i = 0; i < bytes; i++) {
+        if (EOF == (c = getc(f))) {
+            free(half_bytes);
+            return NULL;
+        }
+        half_bytes[i] = (char)c;
+    }
+
+    ascii = half_bytes_to_ASCII(half_bytes, script_length);
+    free(half_bytes);
+    script = edit_script_from_ASCII(ascii);
+    free(ascii);
+    return script;
+}
+
+/*Reads the checkpoint table after the end of the edits of a binary edit script
+  that takes up "length" bytes along with its table, if there is one.*/
+static void
+read_checkpoints(char *script, int32_t length,
+                 struct cb_link_checkpoint **checkpoints,
+                 int32_t *num_checkpoints)
+{
+    struct cb_link_checkpoint *cp, prev = {0, 0, 0, 0};
+    int i, pos;
+
+    *checkpoints = NULL;
+    *num_checkpoints = 0;
+
+    pos = edit_script_size(script);
+    if (pos >= length)
+        return;
+
+    *num_checkpoints = (int32_t)get_varint(script, &pos);
+    *checkpoints = malloc(*num_checkpoints*sizeof(**checkpoints));
+    assert(*checkpoints);
+    for (i = 0; i < *num_checkpoints; i++) {
+        cp = &(*checkpoints)[i];
+        cp->script_pos = prev.script_pos + get_varint(script, &pos);
+        cp->coarse_pos = prev.coarse_pos + get_varint(script, &pos);
+        cp->original_pos = prev.original_pos + get_varint(script, &pos);
+        cp->last_edit_str_len = get_varint(script, &pos);
+        prev = *cp;
+    }
+}
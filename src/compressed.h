@@ -1,6 +1,7 @@
 #ifndef __CABLAST_COMPRESSED_H__
 #define __CABLAST_COMPRESSED_H__
 
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -8,22 +9,35 @@
 
 #include "align.h"
 #include "bitpack.h"
+#include "compressed_cache.h"
 #include "edit_scripts.h"
 #include "link_to_coarse.h"
+#include "mapped_index.h"
 #include "seq.h"
+#include "writer.h"
 
 #include "stdbool.h"
 
+/*compressed.cb starts with this magic string followed by a byte with the
+  version of the file's format.  Files without it are in version 1.*/
+#define CABLAST_COMPRESSED_MAGIC "CBLASTC"
+#define CABLAST_COMPRESSED_VERSION 3
+
+/*The links of a sequence in compressed.cb are sorted by their original start
+  and split into blocks of this many links, each of which can be read on its
+  own.*/
+#define CABLAST_COMPRESSED_LINK_BLOCK 32
+
 struct cb_link_to_coarse *
 cb_link_to_coarse_init(int32_t coarse_seq_id,
                         uint64_t original_start, uint64_t original_end,
-                        uint16_t coarse_start, uint16_t coarse_end,
+                        uint32_t coarse_start, uint32_t coarse_end,
                         struct cb_alignment alignment, bool dir);
 
 struct cb_link_to_coarse *
 cb_link_to_coarse_init_nodiff(int32_t coarse_seq_id,
                                uint64_t original_start, uint64_t original_end,
-                               uint16_t coarse_start, uint16_t coarse_end,
+                               uint32_t coarse_start, uint32_t coarse_end,
                                bool dir);
 
 void
@@ -51,10 +65,49 @@ struct cb_compressed {
     struct DSVector *seqs;
     FILE *file_compressed;
     FILE *file_index;
+    FILE *file_lengths;
+
+    /*Buffers in front of the three files while they are being written,
+      created by the first save, and a lock for writing whole sequences from
+      more than one thread.*/
+    struct cb_writer *writer_compressed;
+    struct cb_writer *writer_index;
+    struct cb_writer *writer_lengths;
+    pthread_mutex_t lock_write;
+
+    /*Sequences given to cb_compressed_write_binary before every sequence with
+      a smaller ID was written, which wait there so that sequences are always
+      written in the order of their IDs, and the ID of the next sequence to
+      write.*/
+    struct cb_compressed_seq **pending;
+    int32_t num_pending;
+    int32_t pending_allocated;
+    int64_t next_write;
+
+    /*A read-only map of file_index, or NULL if the index is being written or
+      could not be mapped.*/
+    struct cb_mapped_index *map_index;
+
+    /*The length of every original sequence, indexed like file_index, once
+      they have been loaded with cb_compressed_load_lengths.*/
+    int64_t *seq_lengths;
+    int32_t num_seq_lengths;
+
+    /*Edit scripts are saved with a checkpoint every checkpoint_interval
+      residues of the original sequence, or none if it is 0.*/
+    int32_t checkpoint_interval;
+
+    /*Recently read compressed sequences, or NULL if they are not cached.*/
+    struct cb_compressed_cache *cache;
+
+    /*Held while a range of a sequence is read from file_compressed, so that
+      more than one thread can expand hits at once.*/
+    pthread_mutex_t lock_read;
 };
 
 struct cb_compressed *
-cb_compressed_init(FILE *file_compressed, FILE *file_index);
+cb_compressed_init(FILE *file_compressed, FILE *file_index,
+                   FILE *file_lengths);
 
 void
 cb_compressed_free(struct cb_compressed *com_db);
@@ -91,6 +144,18 @@ int64_t cb_compressed_link_offset(struct cb_compressed *comdb, int id);
 struct cb_compressed_seq *cb_compressed_read_seq_at(
                                                  struct cb_compressed *comdb,
                                                  int32_t id);
+struct cb_compressed_seq *cb_compressed_read_seq_range(
+                                                 struct cb_compressed *comdb,
+                                                 int32_t id, int64_t start,
+                                                 int64_t end);
 int64_t cb_compressed_get_seq_length(FILE *f);
 int64_t *cb_compressed_get_lengths(struct cb_compressed *comdb);
+void cb_compressed_map_index(struct cb_compressed *comdb);
+void cb_compressed_load_lengths(struct cb_compressed *comdb);
+int64_t cb_compressed_seq_length(struct cb_compressed *comdb, int32_t id);
+int64_t cb_compressed_num_seqs(struct cb_compressed *comdb);
+char **cb_compressed_read_headers(struct cb_compressed *comdb,
+                                  int32_t *count);
+int32_t cb_compressed_convert(FILE *in, FILE *out, FILE *out_index,
+                              FILE *out_lengths, int32_t checkpoint_interval);
 #endif
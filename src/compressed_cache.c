@@ -0,0 +1,240 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compressed.h"
+#include "compressed_cache.h"
+#include "edit_scripts.h"
+
+static struct cb_compressed_seq *
+copy_range(struct cb_compressed_cache_entry *entry, int64_t start,
+           int64_t end);
+
+static struct cb_link_to_coarse *
+copy_link(struct cb_link_to_coarse *link);
+
+static struct cb_compressed_cache_entry *
+make_entry(struct cb_compressed_seq *seq);
+
+static int
+compare_links(const void *a, const void *b);
+
+static void
+free_entry(struct cb_lru_entry *entry);
+
+/*Creates an empty cache that holds at most "capacity" bytes of compressed
+  sequences.*/
+struct cb_compressed_cache *
+cb_compressed_cache_init(int64_t capacity)
+{
+    struct cb_compressed_cache *cache;
+    int32_t errno;
+
+    cache = malloc(sizeof(*cache));
+    assert(cache);
+
+    cache->entries = cb_lru_init(capacity, free_entry);
+    cache->hits = 0;
+    cache->misses = 0;
+
+    if (0 != (errno = pthread_mutex_init(&cache->lock, NULL))) {
+        fprintf(stderr, "Could not create mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+
+    return cache;
+}
+
+void
+cb_compressed_cache_free(struct cb_compressed_cache *cache)
+{
+    int32_t errno;
+
+    if (cache == NULL)
+        return;
+
+    if (0 != (errno = pthread_mutex_destroy(&cache->lock))) {
+        fprintf(stderr, "Could not destroy mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+    cb_lru_free(cache->entries);
+    free(cache);
+}
+
+/*Returns a new compressed sequence with the name of the cached sequence with
+ *the ID passed into id and copies of its links that overlap the original
+ *residues from start up to but not including end, and marks the sequence as
+ *the most recently used.  Returns NULL if the sequence is not in the cache.
+ */
+struct cb_compressed_seq *
+cb_compressed_cache_get(struct cb_compressed_cache *cache, int32_t id,
+                        int64_t start, int64_t end)
+{
+    struct cb_compressed_cache_entry *entry;
+    struct cb_compressed_seq *seq = NULL;
+
+    pthread_mutex_lock(&cache->lock);
+    entry = (struct cb_compressed_cache_entry *)cb_lru_get(cache->entries, id);
+    if (entry != NULL) {
+        cache->hits++;
+        seq = copy_range(entry, start, end);
+    }
+    else
+        cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    return seq;
+}
+
+/*Adds a whole compressed sequence to the cache, which takes ownership of it,
+ *and returns the part of it from start to end like cb_compressed_cache_get.
+ *The least recently used sequences are evicted until the cache is back under
+ *its capacity.  Sequences bigger than the capacity of the cache and
+ *sequences that another thread has already added are freed right away.
+ */
+struct cb_compressed_seq *
+cb_compressed_cache_add(struct cb_compressed_cache *cache,
+                        struct cb_compressed_seq *seq,
+                        int64_t start, int64_t end)
+{
+    struct cb_compressed_cache_entry *entry = make_entry(seq);
+    struct cb_compressed_seq *range = copy_range(entry, start, end);
+    bool added;
+
+    pthread_mutex_lock(&cache->lock);
+    added = cb_lru_add(cache->entries, &entry->lru);
+    pthread_mutex_unlock(&cache->lock);
+
+    if (!added)
+        free_entry(&entry->lru);
+    return range;
+}
+
+/*Copies the part of a cached sequence that overlaps the original residues
+  from start up to but not including end.*/
+static struct cb_compressed_seq *
+copy_range(struct cb_compressed_cache_entry *entry, int64_t start,
+           int64_t end)
+{
+    struct cb_compressed_seq *seq;
+    struct cb_link_to_coarse *link, *last = NULL;
+    int32_t lo = 0, hi = entry->num_links, mid;
+
+    seq = cb_compressed_seq_init(entry->lru.id, entry->seq->name);
+
+    /*max_ends never goes down, so the first link that can overlap the range
+      is the first one with a greatest end of at least start.*/
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if ((int64_t)entry->max_ends[mid] < start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (; lo < entry->num_links &&
+           (int64_t)entry->links[lo]->original_start < end; lo++) {
+        if ((int64_t)entry->links[lo]->original_end < start)
+            continue;
+        link = copy_link(entry->links[lo]);
+        if (last == NULL)
+            seq->links = link;
+        else
+            last->next = link;
+        last = link;
+    }
+    return seq;
+}
+
+static struct cb_link_to_coarse *
+copy_link(struct cb_link_to_coarse *link)
+{
+    struct cb_link_to_coarse *copy;
+    int32_t size = edit_script_size(link->diff);
+
+    copy = malloc(sizeof(*copy));
+    assert(copy);
+    *copy = *link;
+    copy->next = NULL;
+
+    copy->diff = malloc(size*sizeof(*copy->diff));
+    assert(copy->diff);
+    memcpy(copy->diff, link->diff, size);
+
+    if (link->num_checkpoints > 0) {
+        copy->checkpoints = malloc(link->num_checkpoints *
+                                   sizeof(*copy->checkpoints));
+        assert(copy->checkpoints);
+        memcpy(copy->checkpoints, link->checkpoints,
+               link->num_checkpoints * sizeof(*copy->checkpoints));
+    }
+    else
+        copy->checkpoints = NULL;
+    return copy;
+}
+
+/*Makes a cache entry for a whole compressed sequence, counting the bytes of
+  everything in it towards its size.*/
+static struct cb_compressed_cache_entry *
+make_entry(struct cb_compressed_seq *seq)
+{
+    struct cb_compressed_cache_entry *entry;
+    struct cb_link_to_coarse *link;
+    int32_t i;
+
+    entry = malloc(sizeof(*entry));
+    assert(entry);
+
+    entry->lru.id = (int32_t)seq->id;
+    entry->seq = seq;
+    entry->num_links = 0;
+    entry->lru.size = sizeof(*entry) + sizeof(*seq) + strlen(seq->name) + 1;
+    for (link = seq->links; link != NULL; link = link->next) {
+        entry->num_links++;
+        entry->lru.size += sizeof(*link) + sizeof(*entry->links) +
+                           sizeof(*entry->max_ends) +
+                           edit_script_size(link->diff) +
+                           link->num_checkpoints * sizeof(*link->checkpoints);
+    }
+
+    entry->links = malloc((entry->num_links + 1)*sizeof(*entry->links));
+    assert(entry->links);
+    entry->max_ends = malloc((entry->num_links + 1)*sizeof(*entry->max_ends));
+    assert(entry->max_ends);
+
+    for (i = 0, link = seq->links; link != NULL; i++, link = link->next)
+        entry->links[i] = link;
+    qsort(entry->links, entry->num_links, sizeof(*entry->links),
+          compare_links);
+    for (i = 0; i < entry->num_links; i++) {
+        entry->max_ends[i] = entry->links[i]->original_end;
+        if (i > 0 && entry->max_ends[i-1] > entry->max_ends[i])
+            entry->max_ends[i] = entry->max_ends[i-1];
+    }
+
+    return entry;
+}
+
+/*Orders links by their original start.*/
+static int
+compare_links(const void *a, const void *b)
+{
+    const struct cb_link_to_coarse *x = *(struct cb_link_to_coarse **)a;
+    const struct cb_link_to_coarse *y = *(struct cb_link_to_coarse **)b;
+
+    if (x->original_start != y->original_start)
+        return x->original_start < y->original_start ? -1 : 1;
+    return 0;
+}
+
+static void
+free_entry(struct cb_lru_entry *entry)
+{
+    struct cb_compressed_cache_entry *e =
+        (struct cb_compressed_cache_entry *)entry;
+
+    cb_compressed_seq_free(e->seq);
+    free(e->links);
+    free(e->max_ends);
+    free(e);
+}
@@ -0,0 +1,55 @@
+#ifndef __CABLAST_COMPRESSED_CACHE_H__
+#define __CABLAST_COMPRESSED_CACHE_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "link_to_coarse.h"
+#include "lru.h"
+
+/*Records of compressed.cb are only read whole into the cache if at least this
+  many records of their size fit in it, so that one long sequence cannot push
+  everything else out and each miss does not read far more than it needs.*/
+#define CABLAST_COMPRESSED_CACHE_MIN_RECORDS 64
+
+struct cb_compressed_seq;
+
+/*A parsed compressed sequence held in the cache, with its links sorted by
+ *original start and the greatest original end of the links up to each one,
+ *so the links that overlap a range are found by binary search.  Its size is
+ *the number of bytes of everything in it.
+ */
+struct cb_compressed_cache_entry {
+    struct cb_lru_entry lru;
+    struct cb_compressed_seq *seq;
+    struct cb_link_to_coarse **links;
+    uint64_t *max_ends;
+    int32_t num_links;
+};
+
+/*A least recently used cache of whole compressed sequences.  The total size
+  in bytes of the cached sequences never goes over the capacity of
+  "entries".*/
+struct cb_compressed_cache {
+    struct cb_lru *entries;
+    uint64_t hits;
+    uint64_t misses;
+    pthread_mutex_t lock;
+};
+
+struct cb_compressed_cache *
+cb_compressed_cache_init(int64_t capacity);
+
+void
+cb_compressed_cache_free(struct cb_compressed_cache *cache);
+
+struct cb_compressed_seq *
+cb_compressed_cache_get(struct cb_compressed_cache *cache, int32_t id,
+                        int64_t start, int64_t end);
+
+struct cb_compressed_seq *
+cb_compressed_cache_add(struct cb_compressed_cache *cache,
+                        struct cb_compressed_seq *seq,
+                        int64_t start, int64_t end);
+
+#endif
@@ -7,11 +7,13 @@
 #include "compression.h"
 #include "flags.h"
 #include "DNAutils.h"
+#include "dust.h"
 #include "edit_scripts.h"
 
 struct worker_args {
     struct cb_database *db;
     struct DSQueue *jobs;
+    struct cb_compress_workers *workers;
 };
 
 struct extend_match {
@@ -39,9 +41,13 @@ extend_match_with_res(struct cb_align_nw_memory *mem,
                 int32_t current, int32_t dir2);
 
 static int32_t
-add_without_match(struct cb_coarse *coarse_db,
+add_without_match(struct cb_coarse *coarse_db, struct cb_dedup *dedup,
                   struct cb_seq *org_seq, int32_t ostart, int32_t oend);
 
+static struct cb_compressed_seq *
+add_duplicate(struct cb_coarse *coarse_db, struct cb_dedup *dedup,
+              struct cb_seq *org_seq);
+
 static void *
 cb_compress_worker(void *data);
 
@@ -58,17 +64,30 @@ cb_compress_start_workers(struct cb_database *db, int32_t num_workers)
 
     jobs = ds_queue_create(20);
 
-    wargs = malloc(sizeof(*wargs));
-    assert(wargs);
-    wargs->db = db;
-    wargs->jobs = jobs;
-
     workers = malloc(sizeof(*workers));
     assert(workers);
     workers->threads = malloc(num_workers * sizeof(*workers->threads));
     assert(workers->threads);
     workers->num_workers = num_workers;
     workers->jobs = jobs;
+    workers->stats.bases = 0;
+    workers->stats.probes = 0;
+    workers->stats.skipped = 0;
+    workers->stats.masked = 0;
+    workers->stats.dedup_seqs = 0;
+    workers->stats.dedup_chunks = 0;
+    workers->dedup = compress_flags.no_dedup ? NULL : cb_dedup_init();
+
+    if (0 != (errno = pthread_mutex_init(&workers->lock_stats, NULL))) {
+        fprintf(stderr, "Could not create mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+
+    wargs = malloc(sizeof(*wargs));
+    assert(wargs);
+    wargs->db = db;
+    wargs->jobs = jobs;
+    wargs->workers = workers;
     workers->args = (void*) wargs;
 
     for (i = 0; i < num_workers; i++) {
@@ -106,6 +125,9 @@ cb_compress_join_workers(struct cb_compress_workers *workers)
 void
 cb_compress_free_workers(struct cb_compress_workers *workers)
 {
+    pthread_mutex_destroy(&workers->lock_stats);
+    if (workers->dedup != NULL)
+        cb_dedup_free(workers->dedup);
     ds_queue_free(workers->jobs);
     free(workers->args);
     free(workers->threads);
@@ -119,6 +141,23 @@ cb_compress_send_job(struct cb_compress_workers *workers,
     ds_queue_put(workers->jobs, (void*) org_seq);
 }
 
+/*Prints the seed lookup statistics gathered by all workers.  Should only be
+  called after cb_compress_join_workers.*/
+void
+cb_compress_print_stats(struct cb_compress_workers *workers, FILE *out)
+{
+    struct cb_compress_stats *stats = &workers->stats;
+
+    fprintf(out, "Bases compressed:        %lu\n", stats->bases);
+    fprintf(out, "Seed positions probed:   %lu\n", stats->probes);
+    fprintf(out, "Seed positions skipped:  %lu\n", stats->skipped);
+    fprintf(out, "Seed positions masked:   %lu\n", stats->masked);
+    fprintf(out, "Duplicate sequences:     %lu\n", stats->dedup_seqs);
+    fprintf(out, "Duplicate chunks:        %lu\n", stats->dedup_chunks);
+    fprintf(out, "Probes per base:         %0.4f\n",
+            stats->bases > 0 ? (double)stats->probes / stats->bases : 0.0);
+}
+
 static void *
 cb_compress_worker(void *data)
 {
@@ -126,28 +165,45 @@ cb_compress_worker(void *data)
     struct cb_align_nw_memory *mem;
     struct cb_seq *s;
     struct cb_compressed_seq *cseq;
+    struct cb_compress_stats stats;
 
     args = (struct worker_args *) data;
     mem = cb_align_nw_memory_init();
+    stats.bases = 0;
+    stats.probes = 0;
+    stats.skipped = 0;
+    stats.masked = 0;
+    stats.dedup_seqs = 0;
+    stats.dedup_chunks = 0;
     while (NULL != (s = (struct cb_seq *) ds_queue_get(args->jobs))) {
-        cseq = cb_compress(args->db->coarse_db, s, mem);
+        cseq = cb_compress(args->db->coarse_db, s, mem, &stats,
+                           args->workers->dedup);
         cb_compressed_write_binary(args->db->com_db, cseq);
 
         args->db->coarse_db->dbsize += s->length;
 
         cb_seq_free(s);
-        cb_compressed_seq_free(cseq);
     }
 
     cb_align_nw_memory_free(mem);
 
+    pthread_mutex_lock(&args->workers->lock_stats);
+    args->workers->stats.bases += stats.bases;
+    args->workers->stats.probes += stats.probes;
+    args->workers->stats.skipped += stats.skipped;
+    args->workers->stats.masked += stats.masked;
+    args->workers->stats.dedup_seqs += stats.dedup_seqs;
+    args->workers->stats.dedup_chunks += stats.dedup_chunks;
+    pthread_mutex_unlock(&args->workers->lock_stats);
+
     return NULL;
 }
 
 
 struct cb_compressed_seq *
 cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
-             struct cb_align_nw_memory *mem)
+             struct cb_align_nw_memory *mem, struct cb_compress_stats *stats,
+             struct cb_dedup *dedup)
 {
     struct extend_match_with_res mseqs_fwd, mseqs_rev;
     struct cb_coarse_seq *coarse_seq;
@@ -166,10 +222,24 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
 
     int32_t start_of_section, end_of_chunk, end_of_section;
 
-    bool *matches, *matches_temp;
-    bool found_match;
+    /*The number of bases to advance after a position without a match.  It
+      grows while no seed locations are found and resets on a partial hit.*/
+    int32_t skip, max_skip, next;
+
+    bool *matches, *matches_temp, *dust;
+    bool found_match, partial_hit;
     fprintf(stderr, "Starting compression      %d\n", org_seq->id);
 
+    /*An exact copy of a sequence that was already compressed reuses its
+      links without any seed lookups or alignment.*/
+    if (dedup != NULL &&
+          NULL != (cseq = add_duplicate(coarse_db, dedup, org_seq))) {
+        stats->bases += org_seq->length;
+        stats->dedup_seqs++;
+        fprintf(stderr, "Compress finished       %d\n", org_seq->id);
+        return cseq;
+    }
+
     cseq = cb_compressed_seq_init(org_seq->id, org_seq->name);
     seed_size = coarse_db->seeds->seed_size;
     mext = compress_flags.match_extend;
@@ -180,13 +250,25 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
     max_section_size = 2 * max_chunk_size;
     overlap = compress_flags.overlap;
 
+    max_skip = compress_flags.max_seed_skip > 1 ?
+               compress_flags.max_seed_skip : 1;
+    skip = 1;
+
     last_match = 0;
     current = 0;
     start_of_section = 0;
-    end_of_chunk = start_of_section + max_chunk_size;
-    end_of_section = start_of_section + max_section_size;
+    end_of_chunk = min(start_of_section + max_chunk_size,
+                       org_seq->length - ext_seed);
+    end_of_section = min(start_of_section + max_section_size,
+                         org_seq->length - ext_seed);
     chunks = 0;
 
+    stats->bases += org_seq->length;
+
+    /*Seeds that touch a low-complexity region are never looked up.*/
+    dust = cb_dust_mask(org_seq->residues, org_seq->length, seed_size,
+                        compress_flags.dust_window, compress_flags.dust_level);
+
     /*Initialize the matches and matches_temp arrays*/
     matches = malloc(max_section_size*sizeof(*matches));
     matches_temp = malloc(max_section_size*sizeof(*matches_temp));
@@ -198,14 +280,15 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
     for (current = 0; current <= org_seq->length-seed_size - ext_seed;
                                                              current++) {
         found_match = false;
+        partial_hit = false;
 
         /*If we are at the beginning of the first chunk of the first sequence,
          *add the first chunk without a match and skip ahead to the start of
          *the second chunk.
          */
         if (current == 0 && coarse_db->seqs->size == 0) {
-            new_coarse_seq_id = add_without_match(coarse_db, org_seq, 0,
-                                                  max_chunk_size);
+            new_coarse_seq_id = add_without_match(coarse_db, dedup, org_seq, 0,
+                                                  end_of_chunk);
             cb_compressed_seq_addlink(cseq, cb_link_to_coarse_init_nodiff(
                                                  new_coarse_seq_id, 0,
                                                  end_of_chunk - 1, 0,
@@ -220,20 +303,69 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
                 current = start_of_section-1;
             }
             chunks++;
+
+            /*The first chunk already covers the whole sequence.*/
+            if (end_of_chunk >= org_seq->length - ext_seed)
+                break;
+            continue;
+        }
+
+        /*If the chunk starting here is an exact copy of a chunk that was
+          added without a match, link to that chunk without aligning.*/
+        if (dedup != NULL && current == start_of_section &&
+              0 <= (new_coarse_seq_id = cb_dedup_find_chunk(dedup, coarse_db,
+                                          org_seq->residues + start_of_section,
+                                          end_of_chunk - start_of_section))) {
+            coarse_seq = cb_coarse_get(coarse_db, new_coarse_seq_id);
+            cb_coarse_seq_addlink(coarse_seq,
+                cb_link_to_compressed_init(org_seq->id, 0,
+                                           end_of_chunk - start_of_section - 1,
+                                           start_of_section, end_of_chunk - 1,
+                                           true));
+            cb_compressed_seq_addlink(cseq, cb_link_to_coarse_init_nodiff(
+                                                 new_coarse_seq_id,
+                                                 start_of_section,
+                                                 end_of_chunk - 1, 0,
+                                                 end_of_chunk -
+                                                   start_of_section - 1,
+                                                 true));
+            stats->dedup_chunks++;
+            chunks++;
+            skip = 1;
+
+            if (end_of_chunk >= org_seq->length - seed_size - ext_seed - 1)
+                break;
+            start_of_section = end_of_chunk - overlap;
+            end_of_chunk = min(start_of_section + max_chunk_size,
+                               org_seq->length - ext_seed);
+            end_of_section = min(start_of_section + max_section_size,
+                                 org_seq->length - ext_seed);
+            current = start_of_section - 1;
             continue;
         }
 
-        /*Get the k-mer and allocate a copy of its reverse complement*/
-        kmer = get_kmer(org_seq->residues+current, seed_size);
-        revcomp = kmer_revcomp(kmer, seed_size);
+        if (dust != NULL && dust[current]) {
+            stats->masked++;
+            kmer = NULL;
+            revcomp = NULL;
+            seeds = NULL;
+            seeds_r = NULL;
+        }
+        else {
+            stats->probes++;
 
-        /*The locations of all seeds in the database that start with the
-          current k-mer.*/
-        seeds = cb_seeds_lookup(coarse_db->seeds, kmer);
+            /*Get the k-mer and allocate a copy of its reverse complement*/
+            kmer = get_kmer(org_seq->residues+current, seed_size);
+            revcomp = kmer_revcomp(kmer, seed_size);
 
-        /*The locations of all seeds in the database that start with the
-          current k-mer's reverse complement.*/
-        seeds_r = cb_seeds_lookup(coarse_db->seeds, revcomp);
+            /*The locations of all seeds in the database that start with the
+              current k-mer.*/
+            seeds = cb_seeds_lookup(coarse_db->seeds, kmer);
+
+            /*The locations of all seeds in the database that start with the
+              current k-mer's reverse complement.*/
+            seeds_r = cb_seeds_lookup(coarse_db->seeds, revcomp);
+        }
 
         for (seedLoc = seeds; seedLoc != NULL; seedLoc = seedLoc->next) {
             if (found_match)
@@ -257,6 +389,7 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
                               coarse_seq->seq->length, 0)) >
                   compress_flags.attempt_ext_len) {
                 int index;
+                partial_hit = true;
                 mseqs_rev = extend_match_with_res(mem,
                                          coarse_seq->seq->residues, 0,
                                          coarse_seq->seq->length, resind, -1,
@@ -319,7 +452,7 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
                 /*Make a new chunk for the parts of the chunk before the
                   match.*/
                 if (current - rev_olen - start_of_section > 0) {
-                    new_coarse_seq_id = add_without_match(coarse_db, org_seq,
+                    new_coarse_seq_id = add_without_match(coarse_db, dedup, org_seq,
                                                     start_of_section,
                                                     current - rev_olen +
                                                       compress_flags.overlap);
@@ -408,6 +541,7 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
                               coarse_seq->seq->length, 0)) >
                   compress_flags.attempt_ext_len) {
                 int index;
+                partial_hit = true;
                 mseqs_rev = extend_match_with_res(mem,
                                          coarse_seq->seq->residues, 0,
                                          coarse_seq->seq->length, resind, -1,
@@ -472,7 +606,7 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
                 /*Make a new chunk for the parts of the chunk before the
                   match.*/
                 if (current - fwd_olen - start_of_section > 0) {
-                    new_coarse_seq_id = add_without_match(coarse_db, org_seq,
+                    new_coarse_seq_id = add_without_match(coarse_db, dedup, org_seq,
                                                     start_of_section,
                                                     current - fwd_olen +
                                                       compress_flags.overlap);
@@ -533,6 +667,14 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
         }
         free(kmer);
         free(revcomp);
+
+        /*Adapt the skip: back off to every base if a seed here was promising
+          enough to extend, and stride further if there were no seeds at all.*/
+        if (partial_hit)
+            skip = 1;
+        else if (seeds == NULL && seeds_r == NULL)
+            skip = min(2 * skip, max_skip);
+
         cb_seed_loc_free(seeds);
         cb_seed_loc_free(seeds_r);
 
@@ -541,7 +683,7 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
          *start_of_section, end_of_chunk, and end_of_section
          */
         if (current >= end_of_chunk - seed_size && !found_match) {
-            new_coarse_seq_id = add_without_match(coarse_db, org_seq,
+            new_coarse_seq_id = add_without_match(coarse_db, dedup, org_seq,
                                                   start_of_section,
                                                   end_of_chunk);
 
@@ -562,9 +704,24 @@ cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
                 current = start_of_section - 1;
             }
             chunks++;
+            skip = 1;
         }
+        /*Skip ahead, but never past the last seed position of the chunk so
+          that unmatched chunks end at the same place they otherwise would.*/
+        else if (!found_match && skip > 1) {
+            next = min(current + skip, end_of_chunk - seed_size);
+            if (next > current + 1) {
+                stats->skipped += next - current - 1;
+                current = next - 1;
+            }
+        }
+        if (found_match)
+            skip = 1;
     }
     fprintf(stderr, "Compress finished       %d\n", org_seq->id);
+    if (dedup != NULL)
+        cb_dedup_add_seq(dedup, org_seq, cseq);
+    free(dust);
     free(matches);
     free(matches_temp);
     return cseq;
@@ -841,20 +998,54 @@ extend_match(struct cb_align_nw_memory *mem,
  *a link to the sequence being compressed to the new coarse sequence.
  */
 static int32_t
-add_without_match(struct cb_coarse *coarse_db,
+add_without_match(struct cb_coarse *coarse_db, struct cb_dedup *dedup,
                   struct cb_seq *org_seq, int32_t ostart, int32_t oend)
 {
     struct cb_link_to_compressed *link = NULL;
     struct cb_coarse_seq *coarse_seq =
-        cb_coarse_add(coarse_db, org_seq->residues, ostart, oend);
+        cb_coarse_add(coarse_db, org_seq->residues, ostart, oend,
+                      compress_flags.dust_window, compress_flags.dust_level);
     cb_coarse_seq_addlink(
         coarse_seq,
         cb_link_to_compressed_init(org_seq->id, 0, oend - ostart - 1,
                                     ostart, oend - 1, true));
     link = coarse_seq->links;
+    if (dedup != NULL)
+        cb_dedup_add_chunk(dedup, coarse_seq);
     return coarse_seq->id;
 }
 
+/*Compresses an exact duplicate of a sequence that was already compressed by
+ *copying the earlier sequence's links, and adds a link back to the new
+ *sequence to every coarse sequence that it links to.  The earlier sequence
+ *usually spans many coarse chunks, so a single no-diff link cannot stand in
+ *for it.  Returns NULL if the sequence has not been seen before.
+ */
+static struct cb_compressed_seq *
+add_duplicate(struct cb_coarse *coarse_db, struct cb_dedup *dedup,
+              struct cb_seq *org_seq)
+{
+    struct cb_compressed_seq *cseq;
+    struct cb_link_to_coarse *link;
+    bool dir;
+
+    cseq = cb_dedup_find_seq(dedup, coarse_db, org_seq);
+    if (cseq == NULL)
+        return NULL;
+
+    for (link = cseq->links; link != NULL; link = link->next) {
+        dir = (link->diff[0] & ((char)0x7f)) == '0';
+        cb_coarse_seq_addlink(cb_coarse_get(coarse_db, link->coarse_seq_id),
+                              cb_link_to_compressed_init(org_seq->id,
+                                                         link->coarse_start,
+                                                         link->coarse_end,
+                                                         link->original_start,
+                                                         link->original_end,
+                                                         dir));
+    }
+    return cseq;
+}
+
 static int32_t
 min(int32_t a, int32_t b)
 {
@@ -6,6 +6,7 @@
 
 #include <pthread.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #include "ds.h"
 
@@ -13,13 +14,28 @@
 #include "coarse.h"
 #include "compressed.h"
 #include "database.h"
+#include "dedup.h"
 #include "seq.h"
 
+/*Counters for the seed lookup loop in cb_compress.  Each worker keeps its own
+  copy and adds it to the shared copy in cb_compress_workers when it exits.*/
+struct cb_compress_stats {
+    uint64_t bases;
+    uint64_t probes;
+    uint64_t skipped;
+    uint64_t masked;
+    uint64_t dedup_seqs;
+    uint64_t dedup_chunks;
+};
+
 struct cb_compress_workers {
     pthread_t *threads;
     int32_t num_workers;
     struct DSQueue *jobs;
     void *args;
+    struct cb_compress_stats stats;
+    pthread_mutex_t lock_stats;
+    struct cb_dedup *dedup;
 };
 
 struct cb_compress_workers *
@@ -35,8 +51,12 @@ void
 cb_compress_send_job(struct cb_compress_workers *workers,
                       struct cb_seq *org_seq);
 
+void
+cb_compress_print_stats(struct cb_compress_workers *workers, FILE *out);
+
 struct cb_compressed_seq *
 cb_compress(struct cb_coarse *coarse_db, struct cb_seq *org_seq,
-             struct cb_align_nw_memory *mem);
+             struct cb_align_nw_memory *mem, struct cb_compress_stats *stats,
+             struct cb_dedup *dedup);
 
 #endif
@@ -24,17 +24,22 @@ cb_database_init(char *dir, int32_t seed_size, bool add)
     struct cb_database *db;
     struct stat buf;
     FILE *ffasta, *fseeds, *flinks, *fcompressed, *findex_coarse_links,
-         *findex_coarse_fasta, *findex_compressed, *findex_params;
+         *findex_coarse_fasta, *findex_compressed, *findex_params,
+         *flengths_compressed, *fpacked, *findex_packed;
     char *pfasta, *pseeds, *plinks, *pcompressed, *pindex_coarse_links,
-         *pindex_coarse_fasta, *pindex_compressed, *pindex_params;
+         *pindex_coarse_fasta, *pindex_compressed, *pindex_params,
+         *plengths_compressed, *ppacked, *pindex_packed;
 
     pfasta = path_join(dir, CABLAST_COARSE_FASTA);
     pseeds = path_join(dir, CABLAST_COARSE_SEEDS);
     plinks = path_join(dir, CABLAST_COARSE_LINKS);
     pindex_coarse_links = path_join(dir, CABLAST_COARSE_LINKS_INDEX);
     pindex_coarse_fasta = path_join(dir, CABLAST_COARSE_FASTA_INDEX);
+    ppacked = path_join(dir, CABLAST_COARSE_PACKED);
+    pindex_packed = path_join(dir, CABLAST_COARSE_PACKED_INDEX);
     pcompressed = path_join(dir, CABLAST_COMPRESSED);
     pindex_compressed = path_join(dir, CABLAST_COMPRESSED_INDEX);
+    plengths_compressed = path_join(dir, CABLAST_COMPRESSED_LENGTHS);
     pindex_params = path_join(dir, CABLAST_PARAMS);
 
     /* If we're not adding to a database, make sure `dir` does not exist. */
@@ -52,8 +57,11 @@ cb_database_init(char *dir, int32_t seed_size, bool add)
         unlink(plinks);
         unlink(pindex_coarse_links);
         unlink(pindex_coarse_fasta);
+        unlink(ppacked);
+        unlink(pindex_packed);
         unlink(pcompressed);
         unlink(pindex_compressed);
+        unlink(plengths_compressed);
         rmdir(dir);
     }
     /* Otherwise, check to make sure it *does* exist. */
@@ -77,41 +85,57 @@ cb_database_init(char *dir, int32_t seed_size, bool add)
     flinks = open_db_file(plinks, "r+");
     findex_coarse_links = open_db_file(pindex_coarse_links, "r+");
     findex_coarse_fasta = open_db_file(pindex_coarse_fasta, "r+");
+    fpacked = open_db_file(ppacked, "r+");
+    findex_packed = open_db_file(pindex_packed, "r+");
     fcompressed = open_db_file(pcompressed, "r+");
     findex_compressed = open_db_file(pindex_compressed, "r+");
+    flengths_compressed = open_db_file(plengths_compressed, "r+");
     findex_params = open_db_file(pindex_params, "r+");
 
     db->coarse_db = cb_coarse_init(seed_size, ffasta, fseeds, flinks,
                                     findex_coarse_links, findex_coarse_fasta,
-                                    findex_params);
-    db->com_db = cb_compressed_init(fcompressed, findex_compressed);
+                                    fpacked, findex_packed, findex_params);
+    db->com_db = cb_compressed_init(fcompressed, findex_compressed,
+                                    flengths_compressed);
+
+    output_format_header(CABLAST_COARSE_LINKS_MAGIC,
+                         CABLAST_COARSE_LINKS_VERSION, flinks);
+    output_format_header(CABLAST_COMPRESSED_MAGIC, CABLAST_COMPRESSED_VERSION,
+                         fcompressed);
 
     free(pfasta);
     free(pseeds);
     free(plinks);
     free(pindex_coarse_links);
     free(pindex_coarse_fasta);
+    free(ppacked);
+    free(pindex_packed);
     free(pcompressed);
     free(pindex_compressed);
+    free(plengths_compressed);
     free(pindex_params);
 
     return db;
 }
 
 struct cb_database *
-cb_database_read(char *dir, int32_t seed_size)
+cb_database_read(char *dir)
 {
     struct cb_database *db;
     struct stat buf;
     FILE *ffasta, *fseeds, *flinks, *fcompressed, *findex_coarse_links,
-         *findex_coarse_fasta, *findex_compressed, *findex_params;
+         *findex_coarse_fasta, *findex_compressed, *findex_params,
+         *flengths_compressed, *fpacked, *findex_packed;
     char *pfasta  = path_join(dir, CABLAST_COARSE_FASTA);
     char *pseeds = path_join(dir, CABLAST_COARSE_SEEDS);
     char *plinks = path_join(dir, CABLAST_COARSE_LINKS);
     char *pindex_coarse_links = path_join(dir, CABLAST_COARSE_LINKS_INDEX);
     char *pindex_coarse_fasta = path_join(dir, CABLAST_COARSE_FASTA_INDEX);
+    char *ppacked = path_join(dir, CABLAST_COARSE_PACKED);
+    char *pindex_packed = path_join(dir, CABLAST_COARSE_PACKED_INDEX);
     char *pcompressed = path_join(dir, CABLAST_COMPRESSED);
     char *pindex_compressed = path_join(dir, CABLAST_COMPRESSED_INDEX);
+    char *plengths_compressed = path_join(dir, CABLAST_COMPRESSED_LENGTHS);
     char *pindex_params = path_join(dir, CABLAST_PARAMS);
 
     /* Make sure the database directory exists. */
@@ -129,14 +153,36 @@ cb_database_read(char *dir, int32_t seed_size)
     flinks = open_db_file(plinks, "r");
     findex_coarse_links = open_db_file(pindex_coarse_links, "r");
     findex_coarse_fasta = open_db_file(pindex_coarse_fasta, "r");
+    /*Databases made before coarse.packed existed do not have one.*/
+    fpacked = fopen(ppacked, "r");
+    findex_packed = fopen(pindex_packed, "r");
     fcompressed = open_db_file(pcompressed, "r");
     findex_compressed = open_db_file(pindex_compressed, "r");
+    /*Databases made before compressed.cb.lengths existed do not have one.*/
+    flengths_compressed = fopen(plengths_compressed, "r");
     findex_params = open_db_file(pindex_params, "r");
 
-    db->coarse_db = cb_coarse_init(seed_size, ffasta, fseeds, flinks,
+    if (read_format_header(CABLAST_COARSE_LINKS_MAGIC, flinks) !=
+          CABLAST_COARSE_LINKS_VERSION ||
+          read_format_header(CABLAST_COMPRESSED_MAGIC, fcompressed) !=
+          CABLAST_COMPRESSED_VERSION) {
+        fprintf(stderr, "The database in '%s' was made by an older version of "
+                        "cablast-compress. Run cablast-convert on it first.\n",
+                dir);
+        exit(1);
+    }
+
+    /*Nothing is added to the seeds of a database that is read, so it gets no
+      seeds table; lookups go to the mapped coarse.seeds file instead.*/
+    db->coarse_db = cb_coarse_init(0, ffasta, fseeds, flinks,
                                     findex_coarse_links, findex_coarse_fasta,
-                                    findex_params);
-    db->com_db = cb_compressed_init(fcompressed, findex_compressed);
+                                    fpacked, findex_packed, findex_params);
+    db->com_db = cb_compressed_init(fcompressed, findex_compressed,
+                                    flengths_compressed);
+    cb_coarse_map_indexes(db->coarse_db);
+    cb_coarse_map_seeds(db->coarse_db);
+    cb_compressed_map_index(db->com_db);
+    cb_compressed_load_lengths(db->com_db);
 
     return db;
 }
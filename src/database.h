@@ -11,8 +11,12 @@
 #define CABLAST_COARSE_SEEDS "coarse.seeds"
 #define CABLAST_COARSE_LINKS_INDEX "coarse.links.index"
 #define CABLAST_COARSE_FASTA_INDEX "coarse.fasta.index"
+#define CABLAST_COARSE_PACKED "coarse.packed"
+#define CABLAST_COARSE_PACKED_INDEX "coarse.packed.index"
 #define CABLAST_COMPRESSED "compressed.cb"
 #define CABLAST_COMPRESSED_INDEX "compressed.cb.index"
+#define CABLAST_COMPRESSED_LENGTHS "compressed.cb.lengths"
+#define CABLAST_COMPRESSED_NAMES "compressed.cb.names"
 #define CABLAST_PARAMS "params"
 
 struct cb_database {
@@ -25,7 +29,7 @@ struct cb_database *
 cb_database_init(char *dir, int32_t seed_size, bool add);
 
 struct cb_database *
-cb_database_read(char *dir, int32_t seed_size);
+cb_database_read(char *dir);
 
 void cb_database_populate(struct cb_database *db, const char *pfasta,
                            const char *plinks);
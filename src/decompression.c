@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -11,82 +12,331 @@
 #include "compressed.h"
 #include "decompression.h"
 #include "fasta.h"
-#include "range_tree.h"
 #include "seq.h"
 #include "util.h"
 
+/*A compressed sequence read by cb_decompress_write and its position in the
+  output.*/
+struct decompress_job {
+    int64_t index;
+    struct cb_compressed_seq *cseq;
+};
+
+/*The state shared by the threads of cb_decompress_write.  Decompressed
+ *sequences wait in a ring of "window" slots until every sequence before them
+ *has been written; the sequence with index i goes in slot i % window, so a
+ *worker waits before it fills a slot until the writer has caught up to within
+ *"window" sequences of it.  "total" is the number of sequences to write, or -1
+ *until all of them have been read.
+ */
+struct decompress_order {
+    struct cb_coarse *coarsedb;
+    struct DSQueue *jobs;
+    FILE *out;
+    struct cb_seq **slots;
+    int64_t window;
+    int64_t next;
+    int64_t total;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+static void *
+decompress_worker(void *data);
+
+static void *
+decompress_writer(void *data);
+
+static int
+compare_windows(const void *a, const void *b);
+
 /*Takes in an entry in a compressed database and a coarse database and returns
-  the decompressed sequence that the database entry came from as a pointer to
-  a struct cb_seq.*/
+ *the decompressed sequence that the database entry came from as a pointer to
+ *a struct cb_seq.  Each link is decoded from the residues of its coarse
+ *sequence, and the part of it that is past the end of what has already been
+ *decoded is appended.  More than one thread can call this at once.
+ */
 struct cb_seq *cb_decompress_seq(struct cb_compressed_seq *cseq,
                                    struct cb_coarse *coarsedb){
-    uint64_t last_end = 0;
-    int overlap;
-    struct cb_link_to_coarse *link = NULL;
-    struct cb_seq *seq = NULL;
-    int decompressed_length = 0, i = 0, j = 0, copied = 0;
-    struct DSVector *decompressed_chunks = ds_vector_create();
-    char *residues = NULL;
+    struct cb_link_to_coarse *link;
+    struct cb_seq *seq;
+    char *coarse_sub, *dec_chunk, *residues = NULL;
+    int64_t last_end = 0, overlap, length = 0, allocated = 0, chunk_length;
 
     for (link = cseq->links; link != NULL; link = link->next) {
-        int length;
-        char *dec_chunk;
-        struct fasta_seq *chunk = cb_coarse_read_fasta_seq(coarsedb,
-                                                           link->coarse_seq_id);
+        coarse_sub = cb_coarse_read_residues(coarsedb, link->coarse_seq_id,
+                                             link->coarse_start,
+                                             link->coarse_end + 1);
+        dec_chunk = read_edit_script(link->diff, coarse_sub,
+                                     strlen(coarse_sub));
+
+        /*overlap represents the length of the overlap of the parts of the
+          decompressed sequence that have been decoded and the parts of the
+          decompressed sequence currently being decoded.*/
+        overlap = last_end - (int64_t)link->original_start;
+        if (overlap < (int64_t)(link->original_end - link->original_start)) {
+            chunk_length = strlen(dec_chunk + overlap);
+            if (length + chunk_length + 1 > allocated) {
+                allocated = 2 * (length + chunk_length + 1);
+                residues = realloc(residues, allocated * sizeof(*residues));
+                assert(residues);
+            }
+            memcpy(residues + length, dec_chunk + overlap, chunk_length);
+            length += chunk_length;
+        }
+        if ((int64_t)link->original_end > last_end)
+            last_end = link->original_end + 1;
+
+        free(dec_chunk);
+        free(coarse_sub);
+    }
+    if (residues == NULL) {
+        residues = malloc(sizeof(*residues));
+        assert(residues);
+    }
+    residues[length] = '\0';
+
+    /*A sequence too short to have any links has no residues, which
+      cb_seq_init does not allow, so the sequence is made here and takes the
+      decoded residues as they are.*/
+    seq = malloc(sizeof(*seq));
+    assert(seq);
+    seq->id = cseq->id;
+    seq->name = malloc((strlen(cseq->name) + 1)*sizeof(*seq->name));
+    assert(seq->name);
+    strcpy(seq->name, cseq->name);
+    seq->residues = residues;
+    seq->length = length;
+    return seq;
+}
 
-        int coarse_len = link->coarse_end - link->coarse_start;
-        char *coarse_sub = malloc((coarse_len+1)*sizeof(*coarse_sub));
-        assert(coarse_sub);
+/*Decompresses the sequences with the "num_ids" IDs in ids, or every sequence
+ *in the database if ids is NULL, and writes them to out as FASTA in that
+ *order.  The calling thread reads the compressed sequences, "threads" workers
+ *decompress them, and another thread writes them out in order.  At most
+ *CABLAST_DECOMPRESS_WINDOW sequences per worker are held in memory at once,
+ *however big the database is.
+ */
+void
+cb_decompress_write(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
+                    int32_t *ids, int32_t num_ids, FILE *out,
+                    int32_t threads)
+{
+    struct decompress_order order;
+    struct decompress_job *job;
+    struct cb_compressed_seq *cseq;
+    pthread_t *workers, writer;
+    int64_t i, num_seqs, offset;
+    int32_t errno;
 
-        memcpy(coarse_sub, chunk->seq + link->coarse_start, coarse_len);
-        coarse_sub[coarse_len] = '\0';
+    if (threads < 1)
+        threads = 1;
 
-        for (length = 0; chunk->seq[length] != '\0'; length++);
+    order.coarsedb = coarsedb;
+    order.jobs = ds_queue_create(2 * threads);
+    order.out = out;
+    order.window = CABLAST_DECOMPRESS_WINDOW * threads;
+    order.slots = malloc(order.window * sizeof(*order.slots));
+    assert(order.slots);
+    for (i = 0; i < order.window; i++)
+        order.slots[i] = NULL;
+    order.next = 0;
+    order.total = -1;
+    if (0 != (errno = pthread_mutex_init(&order.lock, NULL))) {
+        fprintf(stderr, "Could not create mutex. Errno: %d\n", errno);
+        exit(1);
+    }
+    if (0 != (errno = pthread_cond_init(&order.changed, NULL))) {
+        fprintf(stderr, "Could not create condition. Errno: %d\n", errno);
+        exit(1);
+    }
 
-        /*overlap represents the length of the overlap of the parts of the
-          decompressed sequence that has been printed and the parts of the
-          decompressed sequence currently being decompressed.*/
-        overlap = last_end - link->original_start + 1;
-        dec_chunk = read_edit_script(link->diff, coarse_sub, length);
-
-        /*Print all characters of the decompressed chunk past the index
-          "overlap" unless overlap is greater than the length of the
-          decompressed chunk.*/
-        dec_chunk += overlap;
-        if ((unsigned int)overlap < link->original_end - link->original_start) {
-            int chunk_length = 0;
-            char *section = NULL;
-
-            for (chunk_length=0; dec_chunk[chunk_length]!='\0'; chunk_length++);
-
-            section = malloc((chunk_length + 1)*sizeof(*section));
-            assert(section);
-            for (i = 0; i <= chunk_length; i++)
-                section[i] = dec_chunk[i];
-            ds_vector_append(decompressed_chunks, (void *)section);
-            decompressed_length += chunk_length;
-            if (link->original_end > last_end)
-                last_end = link->original_end;
+    workers = malloc(threads * sizeof(*workers));
+    assert(workers);
+    for (i = 0; i < threads; i++)
+        if (0 != (errno = pthread_create(&workers[i], NULL, decompress_worker,
+                                         &order))) {
+            fprintf(stderr,
+                "cb_decompress_write: Could not start thread. Errno: %d\n",
+                errno);
+            exit(1);
         }
+    if (0 != (errno = pthread_create(&writer, NULL, decompress_writer,
+                                     &order))) {
+        fprintf(stderr,
+            "cb_decompress_write: Could not start thread. Errno: %d\n",
+            errno);
+        exit(1);
+    }
+
+    /*All of the compressed sequences are read one after another from the start
+      of the first one; chosen sequences are found with the index.*/
+    num_seqs = ids != NULL ? num_ids : cb_compressed_num_seqs(comdb);
+    offset = ids == NULL && num_seqs > 0 ?
+             cb_compressed_link_offset(comdb, 0) : 0;
+    if (ids == NULL && offset >= 0 &&
+          fseek(comdb->file_compressed, offset, SEEK_SET) != 0) {
+        fprintf(stderr, "Error in seeking to offset %ld\n", offset);
+        offset = -1;
+    }
+    for (i = 0; offset >= 0 && i < num_seqs; i++) {
+        if (ids != NULL) {
+            if (NULL == (cseq = cb_compressed_read_seq_at(comdb, ids[i]))) {
+                fprintf(stderr, "There is no sequence with ID %d.\n", ids[i]);
+                exit(1);
+            }
+        }
+        else if (NULL == (cseq = get_compressed_seq(comdb->file_compressed,
+                                                    i)))
+            break;
+        job = malloc(sizeof(*job));
+        assert(job);
+        job->index = i;
+        job->cseq = cseq;
+        ds_queue_put(order.jobs, job);
+    }
+    ds_queue_close(order.jobs);
+
+    pthread_mutex_lock(&order.lock);
+    order.total = offset >= 0 ? i : 0;
+    pthread_cond_broadcast(&order.changed);
+    pthread_mutex_unlock(&order.lock);
+
+    for (i = 0; i < threads; i++)
+        if (0 != (errno = pthread_join(workers[i], NULL))) {
+            fprintf(stderr,
+                "cb_decompress_write: Could not join thread. Errno: %d\n",
+                errno);
+            exit(1);
+        }
+    if (0 != (errno = pthread_join(writer, NULL))) {
+        fprintf(stderr,
+            "cb_decompress_write: Could not join thread. Errno: %d\n", errno);
+        exit(1);
+    }
+
+    pthread_mutex_destroy(&order.lock);
+    pthread_cond_destroy(&order.changed);
+    ds_queue_free(order.jobs);
+    free(order.slots);
+    free(workers);
+}
+
+/*Returns a new string with the residues of the original sequence with the ID
+ *passed into id from start up to but not including end, which are clipped to
+ *the ends of the sequence.  Only the links that overlap the range are read
+ *from compressed.cb and decoded.  Returns NULL if there is no such sequence.
+ */
+char *
+cb_decompress_range(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
+                    int32_t id, int64_t start, int64_t end)
+{
+    struct cb_compressed_seq *cseq;
+    struct cb_link_to_coarse *link;
+    char *coarse_sub, *dec_chunk, *residues;
+    int64_t length, from, to;
+
+    if (NULL == (cseq = cb_compressed_read_seq_range(comdb, id, start, end)))
+        return NULL;
+
+    /*Without the lengths of the sequences, the range ends with the last link
+      that overlaps it.*/
+    if ((length = cb_compressed_seq_length(comdb, id)) < 0)
+        for (length = 0, link = cseq->links; link != NULL; link = link->next)
+            if ((int64_t)link->original_end + 1 > length)
+                length = link->original_end + 1;
+    if (start < 0)
+        start = 0;
+    if (end > length)
+        end = length;
+    if (end < start)
+        end = start;
+
+    residues = malloc((end - start + 1)*sizeof(*residues));
+    assert(residues);
+    memset(residues, 'N', end - start);
+    residues[end-start] = '\0';
+
+    for (link = cseq->links; link != NULL; link = link->next) {
+        if ((int64_t)link->original_end < start ||
+              (int64_t)link->original_start >= end)
+            continue;
+
+        coarse_sub = cb_coarse_read_residues(coarsedb, link->coarse_seq_id,
+                                             link->coarse_start,
+                                             link->coarse_end + 1);
+        dec_chunk = read_edit_script(link->diff, coarse_sub,
+                                     strlen(coarse_sub));
+
+        /*dec_chunk[i] is residue original_start + i of the sequence.*/
+        from = (int64_t)link->original_start > start ?
+               (int64_t)link->original_start : start;
+        to = (int64_t)link->original_start + (int64_t)strlen(dec_chunk);
+        if (to > end)
+            to = end;
+        if (to > from)
+            memcpy(residues + (from - start),
+                   dec_chunk + (from - (int64_t)link->original_start),
+                   to - from);
 
-        dec_chunk -= overlap;
         free(dec_chunk);
         free(coarse_sub);
-        fasta_free_seq(chunk);
     }
-    residues = malloc((decompressed_length+1)*sizeof(*residues));
-    assert(residues);
 
-    for (i = 0; i < decompressed_chunks->size; i++) {
-        char *current_chunk = (char *)ds_vector_get(decompressed_chunks, i);
-        for (j = 0; current_chunk[j] != '\0'; j++)
-            residues[copied++] = current_chunk[j];
+    cb_compressed_seq_free(cseq);
+    return residues;
+}
+
+static void *
+decompress_worker(void *data)
+{
+    struct decompress_order *order = (struct decompress_order *)data;
+    struct decompress_job *job;
+    struct cb_seq *seq;
+
+    while (NULL != (job = (struct decompress_job *)ds_queue_get(order->jobs))) {
+        seq = cb_decompress_seq(job->cseq, order->coarsedb);
+        cb_compressed_seq_free(job->cseq);
+
+        pthread_mutex_lock(&order->lock);
+        while (job->index >= order->next + order->window)
+            pthread_cond_wait(&order->changed, &order->lock);
+        order->slots[job->index % order->window] = seq;
+        pthread_cond_broadcast(&order->changed);
+        pthread_mutex_unlock(&order->lock);
+
+        free(job);
     }
-    residues[copied] = '\0';
-    seq = cb_seq_init(cseq->id, cseq->name, residues);
-    ds_vector_free(decompressed_chunks);
-    free(residues);
-    return seq;
+    return NULL;
+}
+
+static void *
+decompress_writer(void *data)
+{
+    struct decompress_order *order = (struct decompress_order *)data;
+    struct cb_seq *seq;
+    int64_t slot;
+
+    while (true) {
+        pthread_mutex_lock(&order->lock);
+        slot = order->next % order->window;
+        while (order->slots[slot] == NULL && order->next != order->total)
+            pthread_cond_wait(&order->changed, &order->lock);
+        if (order->slots[slot] == NULL) {
+            pthread_mutex_unlock(&order->lock);
+            break;
+        }
+        seq = order->slots[slot];
+        order->slots[slot] = NULL;
+        order->next++;
+        pthread_cond_broadcast(&order->changed);
+        pthread_mutex_unlock(&order->lock);
+
+        fprintf(order->out, "> %s\n%s\n",
+                seq->name != NULL ? seq->name : "", seq->residues);
+        cb_seq_free(seq);
+    }
+    return NULL;
 }
 
 int get_min(int a, int b){return a<b?a:b;}
@@ -100,20 +350,46 @@ int get_max(int a, int b){return a>b?a:b;}
  */
 struct DSVector *
 cb_coarse_expand(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
-                 struct DSHashMap *range_trees, int32_t id,
-                 int32_t hit_from, int32_t hit_to, int32_t hit_pad_length){
-    FILE *links = coarsedb->file_links;
-    FILE *coarse_links_index = coarsedb->file_links_index;
-
+                 int32_t id, int32_t hit_from, int32_t hit_to,
+                 int32_t hit_pad_length){
     struct DSVector *oseqs = ds_vector_create();
+    struct DSVector *windows =
+        cb_coarse_expand_windows(coarsedb, comdb, id, hit_from, hit_to,
+                                 hit_pad_length);
+    struct cb_hit_expansion *expansion;
+    int i = 0;
 
-    /*Get all links_to_compressed for the coarse sequence we are expanding.*/
-    struct DSVector *coarse_seq_links =
-        get_coarse_sequence_links_at(links, coarse_links_index, id);
+    for (i = 0; i < windows->size; i++) {
+        expansion = cb_expand_window(coarsedb, comdb,
+                        (struct cb_expansion_window *)ds_vector_get(windows, i));
+        if (expansion != NULL)
+            ds_vector_append(oseqs, (void *)expansion);
+    }
 
-    int64_t *seq_lengths = cb_compressed_get_lengths(comdb);
+    ds_vector_free(windows);
+    return oseqs;
+}
 
-    int i = 0, j = 0;
+/*Takes in the same arguments as cb_coarse_expand and returns a vector of the
+ *windows of original sequences that cb_coarse_expand would decode, one for
+ *each link_to_compressed from the coarse sequence that is in the range
+ *between the indices hit_from and hit_to, without decoding anything.
+ */
+struct DSVector *
+cb_coarse_expand_windows(struct cb_coarse *coarsedb,
+                         struct cb_compressed *comdb, int32_t id,
+                         int32_t hit_from, int32_t hit_to,
+                         int32_t hit_pad_length){
+    struct DSVector *windows = ds_vector_create();
+
+    /*Get the links_to_compressed for the coarse sequence we are expanding
+      that overlap the range for the BLAST Hsp we are expanding from.*/
+    struct DSVector *coarse_seq_links =
+        cb_coarse_read_links_range(coarsedb, id, hit_from, hit_to);
+
+    int i = 0;
+    if (coarse_seq_links == NULL)
+        return windows;
     for (i = 0; i < coarse_seq_links->size; i++) {
         struct cb_link_to_compressed *link =
             (struct cb_link_to_compressed *)ds_vector_get(coarse_seq_links, i);
@@ -121,9 +397,7 @@ cb_coarse_expand(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
         /*Only expand the link if it overlaps the range for the BLAST Hsp we
           are expanding from.*/
         if (link->coarse_start <= hit_to && link->coarse_end >= hit_from) {
-            struct cb_range_tree *tree = NULL;
-            struct cb_link_to_coarse *current = NULL;
-            struct cb_hit_expansion *expansion = NULL;
+            struct cb_expansion_window *window = NULL;
             bool dir = link->dir;
 
             /*Calculate the range in the original sequence for the section of
@@ -148,51 +422,120 @@ cb_coarse_expand(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
                                        (hit_from-link->coarse_start),
                                        link->original_start +
                                        link->coarse_end-hit_from))
-                        + hit_pad_length, seq_lengths[link->org_seq_id] - 1);
-            uint64_t original_range = original_end - original_start + 1;
-
-            struct cb_compressed_seq *seq =
-                       cb_compressed_read_seq_at(comdb, link->org_seq_id);
-
-            char *orig_str = malloc((original_end-original_start+2) *
-                                    sizeof(*orig_str));
-            assert(orig_str);
-
-            for (j = 0; j < (int64_t)(original_end-original_start+1);
-                                                  orig_str[j++]='?');
-            orig_str[original_end-original_start+1] = '\0';
-
-            /*If this is the first time we are expanding the current original
-              sequence, create a new range tree for that sequence.*/
-            if (!ds_geti(range_trees, link->org_seq_id))
-                ds_puti(range_trees, link->org_seq_id,
-                        (void *)cb_range_tree_create(seq->name));
-            tree = (struct cb_range_tree *)ds_geti(range_trees,
-                                                   link->org_seq_id);
-
-            /*Run decode_edit_script for each link_to_coarse in the compressed
-              sequence to re-create the section of the original string.*/ 
-            current = seq->links;
-            for (; current; current = current->next) {
-                int coarse_range = current->coarse_end - current->coarse_start;
-                int init_i0 = current->original_start - (int32_t)original_start;
-                int last_i0 = init_i0 + coarse_range;
-                if (0 < last_i0 && (int32_t)original_range > init_i0)
-                    decode_edit_script(orig_str, original_range,
-                                       original_start, coarsedb, current);
-            }
-            orig_str[original_end-original_start+1] = '\0';
-            cb_range_tree_insert(tree, orig_str, original_start, original_end+1);
-            expansion = cb_hit_expansion_init(link->org_seq_id, seq->name,
-                                              orig_str,(int64_t)original_start);
+                        + hit_pad_length,
+                        cb_compressed_seq_length(comdb, link->org_seq_id) - 1);
 
-            ds_vector_append(oseqs, (void *)expansion);
-            free(orig_str);
-            cb_compressed_seq_free(seq);
+            window = malloc(sizeof(*window));
+            assert(window);
+            window->org_seq_id = link->org_seq_id;
+            window->start = (int64_t)original_start;
+            window->end = (int64_t)original_end + 1;
+            ds_vector_append(windows, (void *)window);
         }
     }
 
-    free(seq_lengths);
     ds_vector_free(coarse_seq_links);
-    return oseqs;
+    return windows;
+}
+
+/*Orders windows by original sequence and then by start.*/
+static int
+compare_windows(const void *a, const void *b)
+{
+    const struct cb_expansion_window *x =
+        *(struct cb_expansion_window **)a;
+    const struct cb_expansion_window *y =
+        *(struct cb_expansion_window **)b;
+
+    if (x->org_seq_id != y->org_seq_id)
+        return x->org_seq_id < y->org_seq_id ? -1 : 1;
+    if (x->start != y->start)
+        return x->start < y->start ? -1 : 1;
+    return 0;
+}
+
+/*Takes in a vector of windows from cb_coarse_expand_windows and returns a new
+ *array of the windows that they cover, in order of original sequence and
+ *start, and sets *num_merged to the number of them.  The windows are sorted
+ *and swept once, and windows of the same sequence that overlap or touch are
+ *merged into one.
+ */
+struct cb_expansion_window *
+cb_merge_windows(struct DSVector *windows, int64_t *num_merged){
+    struct cb_expansion_window **sorted, *merged, *window;
+    int i = 0;
+
+    sorted = malloc((windows->size + 1)*sizeof(*sorted));
+    assert(sorted);
+    merged = malloc((windows->size + 1)*sizeof(*merged));
+    assert(merged);
+
+    for (i = 0; i < windows->size; i++)
+        sorted[i] = (struct cb_expansion_window *)ds_vector_get(windows, i);
+    qsort(sorted, windows->size, sizeof(*sorted), compare_windows);
+
+    *num_merged = 0;
+    for (i = 0; i < windows->size; i++) {
+        window = sorted[i];
+        if (window->end <= window->start)
+            continue;
+        if (*num_merged > 0 &&
+              merged[*num_merged-1].org_seq_id == window->org_seq_id &&
+              merged[*num_merged-1].end >= window->start) {
+            if (window->end > merged[*num_merged-1].end)
+                merged[*num_merged-1].end = window->end;
+        }
+        else
+            merged[(*num_merged)++] = *window;
+    }
+
+    free(sorted);
+    return merged;
+}
+
+/*Takes in a coarse database, a compressed database and a window of an
+ *original sequence and returns a cb_hit_expansion with the residues of the
+ *window, or NULL if the sequence cannot be read.  Only the links that overlap
+ *the window are read, and only the part of each that is in the window is
+ *decoded; residues that no link covers are '?'.
+ */
+struct cb_hit_expansion *
+cb_expand_window(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
+                 struct cb_expansion_window *window){
+    struct cb_link_to_coarse *current = NULL;
+    struct cb_hit_expansion *expansion = NULL;
+    uint64_t original_start = window->start;
+    uint64_t original_range = window->end - window->start;
+    char *orig_str;
+    int j = 0;
+
+    struct cb_compressed_seq *seq =
+               cb_compressed_read_seq_range(comdb, window->org_seq_id,
+                                            window->start, window->end);
+    if (seq == NULL)
+        return NULL;
+
+    orig_str = malloc((original_range+1) * sizeof(*orig_str));
+    assert(orig_str);
+
+    for (j = 0; j < (int64_t)original_range; orig_str[j++]='?');
+    orig_str[original_range] = '\0';
+
+    /*Run decode_edit_script for each link_to_coarse in the range of the
+      compressed sequence to re-create the section of the original string.*/
+    for (current = seq->links; current; current = current->next) {
+        int coarse_range = current->coarse_end - current->coarse_start;
+        int init_i0 = current->original_start - (int32_t)original_start;
+        int last_i0 = init_i0 + coarse_range;
+        if (0 < last_i0 && (int32_t)original_range > init_i0)
+            decode_edit_script(orig_str, original_range,
+                               original_start, coarsedb, current);
+    }
+    orig_str[original_range] = '\0';
+    expansion = cb_hit_expansion_init(window->org_seq_id, seq->name,
+                                      orig_str, (int64_t)original_start);
+
+    free(orig_str);
+    cb_compressed_seq_free(seq);
+    return expansion;
 }
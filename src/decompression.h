@@ -11,11 +11,43 @@
 #include "compressed.h"
 #include "seq.h"
 
+/*The number of decompressed sequences per worker that cb_decompress_write
+  holds at once while it waits to write them in order.*/
+#define CABLAST_DECOMPRESS_WINDOW 4
+
+/*The number of coarse residues cablast-decompress caches when the database
+  has no packed residues to read from.*/
+#define CABLAST_DECOMPRESS_CACHE_SIZE (1 << 28)
+
+/*A section of an original sequence, from start up to but not including end,
+  that a coarse BLAST hit is expanded to.*/
+struct cb_expansion_window {
+    int32_t org_seq_id;
+    int64_t start;
+    int64_t end;
+};
+
 struct cb_seq *cb_decompress_seq(struct cb_compressed_seq *cseq,
                                    struct cb_coarse *coarsedb);
+void
+cb_decompress_write(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
+                    int32_t *ids, int32_t num_ids, FILE *out,
+                    int32_t threads);
+char *
+cb_decompress_range(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
+                    int32_t id, int64_t start, int64_t end);
 struct DSVector *
 cb_coarse_expand(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
-                 struct DSHashMap *range_trees, int32_t id,
-                 int32_t start, int32_t end, int32_t hit_pad_length);
+                 int32_t id, int32_t start, int32_t end,
+                 int32_t hit_pad_length);
+struct DSVector *
+cb_coarse_expand_windows(struct cb_coarse *coarsedb,
+                         struct cb_compressed *comdb, int32_t id,
+                         int32_t start, int32_t end, int32_t hit_pad_length);
+struct cb_expansion_window *
+cb_merge_windows(struct DSVector *windows, int64_t *num_merged);
+struct cb_hit_expansion *
+cb_expand_window(struct cb_coarse *coarsedb, struct cb_compressed *comdb,
+                 struct cb_expansion_window *window);
 
 #endif
@@ -0,0 +1,295 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coarse.h"
+#include "compressed.h"
+#include "dedup.h"
+#include "edit_scripts.h"
+#include "seq.h"
+
+static struct cb_link_to_coarse *
+copy_links(struct cb_link_to_coarse *links);
+
+static bool
+link_matches(struct cb_coarse *coarse_db, struct cb_link_to_coarse *link,
+             const char *residues, int32_t length);
+
+/*Creates empty tables of compressed sequences and unmatched coarse chunks,
+  keyed by the hash of their residues.*/
+struct cb_dedup *
+cb_dedup_init()
+{
+    struct cb_dedup *dedup;
+    int32_t errno;
+    int32_t i;
+
+    dedup = malloc(sizeof(*dedup));
+    assert(dedup);
+
+    dedup->seqs = malloc(CABLAST_DEDUP_BUCKETS * sizeof(*dedup->seqs));
+    assert(dedup->seqs);
+    dedup->chunks = malloc(CABLAST_DEDUP_BUCKETS * sizeof(*dedup->chunks));
+    assert(dedup->chunks);
+    for (i = 0; i < CABLAST_DEDUP_BUCKETS; i++) {
+        dedup->seqs[i] = NULL;
+        dedup->chunks[i] = NULL;
+    }
+
+    if (0 != (errno = pthread_rwlock_init(&dedup->lock, NULL))) {
+        fprintf(stderr, "Could not create rwlock. Errno: %d\n", errno);
+        exit(1);
+    }
+
+    return dedup;
+}
+
+void
+cb_dedup_free(struct cb_dedup *dedup)
+{
+    struct cb_dedup_seq *s1, *s2;
+    struct cb_dedup_chunk *c1, *c2;
+    struct cb_link_to_coarse *l1, *l2;
+    int32_t errno;
+    int32_t i;
+
+    if (0 != (errno = pthread_rwlock_destroy(&dedup->lock))) {
+        fprintf(stderr, "Could not destroy rwlock. Errno: %d\n", errno);
+        exit(1);
+    }
+    for (i = 0; i < CABLAST_DEDUP_BUCKETS; i++) {
+        for (s1 = dedup->seqs[i]; s1 != NULL; s1 = s2) {
+            s2 = s1->next;
+            for (l1 = s1->links; l1 != NULL; l1 = l2) {
+                l2 = l1->next;
+                cb_link_to_coarse_free(l1);
+            }
+            free(s1);
+        }
+        for (c1 = dedup->chunks[i]; c1 != NULL; c1 = c2) {
+            c2 = c1->next;
+            free(c1);
+        }
+    }
+    free(dedup->seqs);
+    free(dedup->chunks);
+    free(dedup);
+}
+
+/*The 64-bit FNV-1a hash of a run of residues.*/
+uint64_t
+cb_dedup_hash(const char *residues, int32_t length)
+{
+    uint64_t hash = (uint64_t)14695981039346656037UL;
+    int32_t i;
+
+    for (i = 0; i < length; i++) {
+        hash ^= (uint64_t)(unsigned char)residues[i];
+        hash *= (uint64_t)1099511628211UL;
+    }
+    return hash;
+}
+
+/*Records a coarse sequence that was added without a match so that later
+  sections of original sequences with the same residues can link to it.*/
+void
+cb_dedup_add_chunk(struct cb_dedup *dedup, struct cb_coarse_seq *coarse_seq)
+{
+    struct cb_dedup_chunk *chunk;
+    uint64_t hash;
+
+    hash = cb_dedup_hash(coarse_seq->seq->residues, coarse_seq->seq->length);
+
+    chunk = malloc(sizeof(*chunk));
+    assert(chunk);
+    chunk->hash = hash;
+    chunk->coarse_seq_id = coarse_seq->id;
+
+    pthread_rwlock_wrlock(&dedup->lock);
+    chunk->next = dedup->chunks[hash & (CABLAST_DEDUP_BUCKETS - 1)];
+    dedup->chunks[hash & (CABLAST_DEDUP_BUCKETS - 1)] = chunk;
+    pthread_rwlock_unlock(&dedup->lock);
+}
+
+/*Returns the ID of a coarse sequence whose residues are exactly the "length"
+  residues passed in, or -1 if there is no such coarse sequence.*/
+int32_t
+cb_dedup_find_chunk(struct cb_dedup *dedup, struct cb_coarse *coarse_db,
+                    const char *residues, int32_t length)
+{
+    struct cb_dedup_chunk *chunk;
+    struct cb_coarse_seq *coarse_seq;
+    uint64_t hash;
+    int32_t id = -1;
+
+    hash = cb_dedup_hash(residues, length);
+
+    pthread_rwlock_rdlock(&dedup->lock);
+    chunk = dedup->chunks[hash & (CABLAST_DEDUP_BUCKETS - 1)];
+    for (; chunk != NULL; chunk = chunk->next) {
+        if (chunk->hash != hash)
+            continue;
+        coarse_seq = cb_coarse_get(coarse_db, chunk->coarse_seq_id);
+        if (coarse_seq->seq->length == length &&
+              0 == memcmp(coarse_seq->seq->residues, residues, length)) {
+            id = chunk->coarse_seq_id;
+            break;
+        }
+    }
+    pthread_rwlock_unlock(&dedup->lock);
+
+    return id;
+}
+
+/*Records the links that an original sequence was compressed to so that exact
+  duplicates of the sequence can reuse them.*/
+void
+cb_dedup_add_seq(struct cb_dedup *dedup, struct cb_seq *org_seq,
+                 struct cb_compressed_seq *cseq)
+{
+    struct cb_dedup_seq *seq, *s;
+    uint64_t hash;
+
+    if (cseq->links == NULL)
+        return;
+
+    hash = cb_dedup_hash(org_seq->residues, org_seq->length);
+
+    seq = malloc(sizeof(*seq));
+    assert(seq);
+    seq->hash = hash;
+    seq->length = org_seq->length;
+    seq->links = copy_links(cseq->links);
+
+    pthread_rwlock_wrlock(&dedup->lock);
+    for (s = dedup->seqs[hash & (CABLAST_DEDUP_BUCKETS - 1)]; s; s = s->next)
+        if (s->hash == hash && s->length == seq->length)
+            break;
+    if (s == NULL) {
+        seq->next = dedup->seqs[hash & (CABLAST_DEDUP_BUCKETS - 1)];
+        dedup->seqs[hash & (CABLAST_DEDUP_BUCKETS - 1)] = seq;
+        seq = NULL;
+    }
+    pthread_rwlock_unlock(&dedup->lock);
+
+    /*An identical sequence was added by another worker in the meantime.*/
+    if (seq != NULL) {
+        struct cb_link_to_coarse *l1, *l2;
+        for (l1 = seq->links; l1 != NULL; l1 = l2) {
+            l2 = l1->next;
+            cb_link_to_coarse_free(l1);
+        }
+        free(seq);
+    }
+}
+
+/*Looks up an original sequence among the sequences that have already been
+ *compressed.  If an earlier sequence had the same residues, returns a new
+ *compressed sequence with a copy of its links.  Every copied link is decoded
+ *against the coarse database and compared with the residues of org_seq, so a
+ *hash collision can never produce a wrong sequence.  Returns NULL if there is
+ *no verified duplicate.
+ */
+struct cb_compressed_seq *
+cb_dedup_find_seq(struct cb_dedup *dedup, struct cb_coarse *coarse_db,
+                  struct cb_seq *org_seq)
+{
+    struct cb_dedup_seq *s;
+    struct cb_link_to_coarse *links = NULL, *link, *next;
+    struct cb_compressed_seq *cseq;
+    uint64_t hash;
+
+    hash = cb_dedup_hash(org_seq->residues, org_seq->length);
+
+    pthread_rwlock_rdlock(&dedup->lock);
+    for (s = dedup->seqs[hash & (CABLAST_DEDUP_BUCKETS - 1)]; s; s = s->next)
+        if (s->hash == hash && s->length == org_seq->length) {
+            links = copy_links(s->links);
+            break;
+        }
+    pthread_rwlock_unlock(&dedup->lock);
+
+    if (links == NULL)
+        return NULL;
+
+    cseq = cb_compressed_seq_init(org_seq->id, org_seq->name);
+    for (link = links; link != NULL; link = next) {
+        next = link->next;
+        link->next = NULL;
+        cb_compressed_seq_addlink(cseq, link);
+        if (!link_matches(coarse_db, link, org_seq->residues,
+                          org_seq->length)) {
+            for (link = next; link != NULL; link = next) {
+                next = link->next;
+                cb_link_to_coarse_free(link);
+            }
+            cb_compressed_seq_free(cseq);
+            return NULL;
+        }
+    }
+
+    return cseq;
+}
+
+/*Returns a deep copy of a list of links to the coarse database.*/
+static struct cb_link_to_coarse *
+copy_links(struct cb_link_to_coarse *links)
+{
+    struct cb_link_to_coarse *first = NULL, *last = NULL, *copy;
+    int32_t size;
+
+    for (; links != NULL; links = links->next) {
+        copy = malloc(sizeof(*copy));
+        assert(copy);
+
+        *copy = *links;
+        size = edit_script_size(links->diff);
+        copy->diff = malloc(size * sizeof(*copy->diff));
+        assert(copy->diff);
+        memcpy(copy->diff, links->diff, size);
+        copy->checkpoints = NULL;
+        copy->num_checkpoints = 0;
+        copy->next = NULL;
+
+        if (first == NULL)
+            first = copy;
+        else
+            last->next = copy;
+        last = copy;
+    }
+    return first;
+}
+
+/*Checks that applying a link to its coarse sequence re-creates the residues
+  of the original sequence in the link's original range.*/
+static bool
+link_matches(struct cb_coarse *coarse_db, struct cb_link_to_coarse *link,
+             const char *residues, int32_t length)
+{
+    struct cb_coarse_seq *coarse_seq;
+    struct cb_seq *chunk;
+    char *decoded;
+    int32_t olen;
+    bool same;
+
+    coarse_seq = cb_coarse_get(coarse_db, link->coarse_seq_id);
+    if (coarse_seq == NULL || link->coarse_end < link->coarse_start ||
+          link->coarse_end >= (uint32_t)coarse_seq->seq->length ||
+          link->original_end < link->original_start ||
+          link->original_end >= (uint64_t)length)
+        return false;
+
+    chunk = cb_seq_init_range(-1, "", coarse_seq->seq->residues,
+                              link->coarse_start, link->coarse_end + 1);
+    decoded = read_edit_script(link->diff, chunk->residues, chunk->length);
+
+    olen = link->original_end - link->original_start + 1;
+    same = (int32_t)strlen(decoded) == olen &&
+           0 == strncmp(decoded, residues + link->original_start, olen);
+
+    free(decoded);
+    cb_seq_free(chunk);
+    return same;
+}
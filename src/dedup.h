@@ -0,0 +1,63 @@
+#ifndef __CABLAST_DEDUP_H__
+#define __CABLAST_DEDUP_H__
+
+/* Apparently this is required to make pthread_rwlock* stuff available. */
+#define __USE_UNIX98
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "coarse.h"
+#include "compressed.h"
+#include "seq.h"
+
+#define CABLAST_DEDUP_BUCKETS (1 << 16)
+
+/*A sequence that has already been compressed, along with a copy of the links
+  that were used to compress it.*/
+struct cb_dedup_seq {
+    uint64_t hash;
+    int32_t length;
+    struct cb_link_to_coarse *links;
+    struct cb_dedup_seq *next;
+};
+
+/*A coarse sequence that was added without a match, and so holds an exact copy
+  of a section of an original sequence.*/
+struct cb_dedup_chunk {
+    uint64_t hash;
+    int32_t coarse_seq_id;
+    struct cb_dedup_chunk *next;
+};
+
+struct cb_dedup {
+    struct cb_dedup_seq **seqs;
+    struct cb_dedup_chunk **chunks;
+    pthread_rwlock_t lock;
+};
+
+struct cb_dedup *
+cb_dedup_init();
+
+void
+cb_dedup_free(struct cb_dedup *dedup);
+
+uint64_t
+cb_dedup_hash(const char *residues, int32_t length);
+
+void
+cb_dedup_add_chunk(struct cb_dedup *dedup, struct cb_coarse_seq *coarse_seq);
+
+int32_t
+cb_dedup_find_chunk(struct cb_dedup *dedup, struct cb_coarse *coarse_db,
+                    const char *residues, int32_t length);
+
+void
+cb_dedup_add_seq(struct cb_dedup *dedup, struct cb_seq *org_seq,
+                 struct cb_compressed_seq *cseq);
+
+struct cb_compressed_seq *
+cb_dedup_find_seq(struct cb_dedup *dedup, struct cb_coarse *coarse_db,
+                  struct cb_seq *org_seq);
+
+#endif
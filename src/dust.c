@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "dust.h"
+
+static int32_t
+base_code(char base);
+
+/*Finds low-complexity regions (microsatellites, homopolymers and the like) in
+ *a DNA sequence with a streaming version of the symmetric DUST score.
+ *
+ *A window of "window" bases is scored from the counts c_t of each of its 64
+ *triplets as sum(c_t * (c_t - 1) / 2) / (l - 1), where l is the number of
+ *triplets in the window.  The counts and the sum are updated as the window
+ *slides, so scoring the whole sequence is linear in its length.  Every base
+ *of a window scoring more than level / 10 is marked as low-complexity.
+ *
+ *Returns an array with one entry per position in the sequence.  Entry i is
+ *true if any of the "span" bases starting at i is low-complexity, so passing
+ *the seed size gives a mask of the seeds that should be ignored.  Returns
+ *NULL if level or window is not positive, meaning nothing is masked.
+ */
+bool *
+cb_dust_mask(const char *residues, int32_t length, int32_t span,
+             int32_t window, int32_t level)
+{
+    bool *masked;
+    int32_t *triplets;
+    int32_t counts[64];
+    int32_t num_triplets, score, masked_end, nearest;
+    int32_t i, t, code;
+
+    if (level <= 0 || window < 4 || length <= 0)
+        return NULL;
+
+    masked = malloc(length * sizeof(*masked));
+    assert(masked);
+    triplets = malloc(length * sizeof(*triplets));
+    assert(triplets);
+
+    for (i = 0; i < length; i++)
+        masked[i] = false;
+    for (i = 0; i < 64; i++)
+        counts[i] = 0;
+
+    /*triplets[i] is the code of the triplet starting at i, or -1 if it
+      contains a residue other than A, C, G or T.*/
+    for (i = 0; i < length; i++) {
+        triplets[i] = -1;
+        if (i + 2 >= length)
+            continue;
+        code = base_code(residues[i]);
+        if (code < 0 || (t = base_code(residues[i+1])) < 0)
+            continue;
+        code = (code << 2) | t;
+        if ((t = base_code(residues[i+2])) < 0)
+            continue;
+        triplets[i] = (code << 2) | t;
+    }
+
+    /*Slide the window over the triplets.  The window starting at base i
+      covers the triplets starting at i through i + window - 3.*/
+    num_triplets = 0;
+    score = 0;
+    masked_end = 0;
+    for (i = 0; i + 2 < length; i++) {
+        if ((t = triplets[i]) >= 0) {
+            score += counts[t]++;
+            num_triplets++;
+        }
+        if (i >= window - 2 && (t = triplets[i - window + 2]) >= 0) {
+            score -= --counts[t];
+            num_triplets--;
+        }
+        if (i >= window - 3 && num_triplets > 1 &&
+              10 * score > level * (num_triplets - 1)) {
+            int32_t start = i - window + 3, end = i + 3;
+            for (t = start > masked_end ? start : masked_end; t < end; t++)
+                masked[t] = true;
+            masked_end = end;
+        }
+    }
+    free(triplets);
+
+    /*Widen the mask so that position i is masked if any base in
+      [i, i + span) is.*/
+    nearest = -1;
+    for (i = length - 1; span > 1 && i >= 0; i--) {
+        if (masked[i])
+            nearest = i;
+        masked[i] = nearest >= 0 && nearest < i + span;
+    }
+
+    return masked;
+}
+
+static int32_t
+base_code(char base)
+{
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default:  return -1;
+    }
+}
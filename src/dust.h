@@ -0,0 +1,11 @@
+#ifndef __CABLAST_DUST_H__
+#define __CABLAST_DUST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool *
+cb_dust_mask(const char *residues, int32_t length, int32_t span,
+             int32_t window, int32_t level);
+
+#endif
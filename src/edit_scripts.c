@@ -4,70 +4,34 @@
 #include <stdlib.h>
 #include <stdbool.h>
 
+#include "bitpack.h"
 #include "coarse.h"
 #include "DNAutils.h"
 #include "edit_scripts.h"
-#include "fasta.h"
 #include "link_to_coarse.h"
 
 int minimum(int a, int b){return a<b?a:b;}
 int maximum(int a, int b){return a>b?a:b;}
 
-/*Converts an integer to its octal representation*/
-char *to_octal_str(int i) {
-    char *buf = malloc(16*sizeof(*buf));
-    assert(buf);
-    sprintf(buf, "%o", i);
-    return buf;
-}
+static int32_t
+edit_form(char *residues, int32_t length);
 
-/*The initialization function for an edit_info struct*/
-struct edit_info *edit_info_create(){
-    struct edit_info *edit = malloc(sizeof(*edit));
-    assert(edit);
-    edit->is_subdel = false;
-    edit->last_dist = 0;
-    edit->str = NULL;
-    edit->str_length = 0;
-    return edit;
-}
+static int32_t
+edit_size(int32_t dist, char *residues, int32_t length);
 
-/*Frees an edit_info struct and its string if it has one*/
-void edit_info_free(struct edit_info *edit){
-    if (edit->str != NULL)
-        free(edit->str);
-    free(edit);
-}
+static int32_t
+put_edit(char *buf, int32_t pos, int32_t dist, bool is_subdel,
+         char *residues, int32_t length);
 
-/*Converts a character in an edit script to a half-byte representing the 
-  character.*/
-char to_half_byte(char c){
-    switch (c) {
-        case '0': return (char)0;
-        case '1': return (char)1;
-        case '2': return (char)2;
-        case '3': return (char)3;
-        case '4': return (char)4;
-        case '5': return (char)5;
-        case '6': return (char)6;
-        case '7': return (char)7;
-        case 'A': return (char)8;
-        case 'C': return (char)9;
-        case 'G': return (char)10;
-        case 'T': return (char)11;
-        case '-': return (char)12;
-        case 'i': return (char)13;
-        case 's': return (char)14;
-        /*For direction bytes with a 1 as the first bit to indicate that
-         *the script is from a match, move the 1 to the leftmost bit of the
-         *half-byte.
-         */
-        case '0' | (char)0x80: return (char)8;
-        case '9' | (char)0x80: return (char)9;
-        /*'N' is represented as the half byte 1111*/
-        default:  return (char)15;
-    }
-}
+static int32_t
+base_code(char base);
+
+static struct cb_link_checkpoint *
+nearest_checkpoint(struct cb_link_to_coarse *link, int32_t original_pos);
+
+static bool
+next_ASCII_edit(char *edit_script, int *pos, int *dist, bool *is_subdel,
+                char **residues, int *length);
 
 /*Converts a half-byte to its corresponding edit script character*/
 char half_byte_to_char(char h){
@@ -85,42 +49,10 @@ char half_byte_to_char(char h){
     }
 }
 
-/*Converts the ASCII string for an edit script to half-byte format*/
-char *edit_script_to_half_bytes(char *edit_script){
-    int i = 0;
-    int length = 0;
-    int odd;
-    char *half_bytes;
-
-    while (edit_script[length] != '\0')
-        length++;
-
-    odd = length % 2;
-    length = length / 2 + odd;
-    half_bytes = malloc(length*sizeof(*half_bytes));
-    assert(half_bytes);
- 
-    while (edit_script[i] != '\0') {
-        if (i%2 == 0)
-            half_bytes[i/2] = (char)0;
-        else
-            half_bytes[i/2] <<= 4;
-        /*Insert the current half byte into the current byte*/
-        half_bytes[i/2] |= to_half_byte(edit_script[i]);
-        i++;
-    }
-    /*If the length of the edit script is odd, to signify the end of the edit
-     *script add a 1 to signify the end of the script since this is incorrect
-     *edit script syntax.
-     */
-    if (odd) {
-        half_bytes[i/2] <<= 4;
-        half_bytes[i/2] |= (char)1;
-    }
-    return half_bytes;
-}
-
-/*Converts an edit script in half-byte format to ASCII*/
+/*Converts an edit script in half-byte format, as written by versions of
+ *cablast-compress before binary edit scripts, to ASCII.  Use
+ *edit_script_from_ASCII to convert the result to a binary edit script.
+ */
 char *half_bytes_to_ASCII(char *half_bytes, int length){
     int i = 0;
     char *edit_script = malloc((length+1)*sizeof(*edit_script));
@@ -153,131 +85,199 @@ char *half_bytes_to_ASCII(char *half_bytes, int length){
 }
 
 /*Takes in as input two strings, a bool representing whether or not they are
- *in the same direction, and the length of the strings and returns an edit
- *script that can convert the reference string to the original string.
+ *in the same direction, and the length of the strings and returns a binary
+ *edit script that can convert the reference string to the original string.
+ *
+ *The script is measured in a first pass over the alignment so that it can be
+ *written into a single allocation of exactly the right size.
  */
 char *make_edit_script(char *str, char *ref, bool dir, int length){
     /*direction has its first bit set to 1 to indicate that the edit script
       was made from a match*/
-    bool insert_open = false, subdel_open = false;
-    int last_edit = 0;
-    char *edit_script = malloc(3*length*sizeof(*edit_script));
-    assert(edit_script);
-
-    int current = 1;
+    char direction = (dir ? '0' : '1') | ((char)0x80);
+    char *edit_script = NULL;
+    int32_t size = 2, current = 1;
+    int last_edit, pass;
     int i, j;
-    char *octal;
-    char direction = (dir ? '0' : '1');
-    direction |= ((char)0x80);
+    bool insert;
 
-    edit_script[0] = direction;
-    for (i = 0; i < length; i++) {
-        if (str[i] == ref[i]) {
-            insert_open = false;
-            subdel_open = false;
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            edit_script = malloc(size*sizeof(*edit_script));
+            assert(edit_script);
+            edit_script[0] = direction;
         }
-        else { /* mismatch */
-            /* insertion in str relative to ref (i.e., gap in ref) */
-            if (ref[i] == '-') {
-                subdel_open = false;
-                /* indicate start of insertion */
-                if (!insert_open) { 
-                    insert_open = true;
-                    octal = to_octal_str(i - last_edit);
-                    edit_script[current++] = 'i';
-                    for (j = 0; octal[j] != '\0'; j++)
-                        edit_script[current++] = octal[j];
-                    last_edit = i;
-                }
-                edit_script[current++] = str[i];
-            }
-            /*substitution or deletion in str (represented in script by '-')
-              relative to ref*/
-            else {
-                insert_open = false;
-                /* indicate start of subdel */
-                if (!subdel_open) { 
-                    subdel_open = true;
-                    octal = to_octal_str(i - last_edit);
-                    edit_script[current++] = 's';
-                    for (j = 0; octal[j] != '\0'; j++)
-                        edit_script[current++] = octal[j];
-                    last_edit = i;
-                }
-                edit_script[current++] = str[i];
+        last_edit = 0;
+        for (i = 0; i < length; i = j) {
+            if (str[i] == ref[i]) {
+                j = i + 1;
+                continue;
             }
+            /*An edit is a run of insertions in str relative to ref (i.e., gaps
+             *in ref) or a run of substitutions and deletions in str
+             *(represented in the script by '-') relative to ref.
+             */
+            insert = ref[i] == '-';
+            for (j = i + 1; j < length && str[j] != ref[j] &&
+                            (ref[j] == '-') == insert; j++);
+
+            if (pass == 0)
+                size += edit_size(i - last_edit, str + i, j - i);
+            else
+                current = put_edit(edit_script, current, i - last_edit,
+                                   !insert, str + i, j - i);
+            last_edit = i;
         }
     }
-    edit_script = realloc(edit_script, (current+1)*sizeof(*edit_script));
-    assert(edit_script);
-
     edit_script[current] = '\0';
     return edit_script;
 }
 
-/*Reads one edit worth of info (or fails if current decoded char is digit)
- *moves pos accordingly.  If there is an edit to read, next_edit reads in
- *the edit and returns true.  Otherwise, next_edit returns false.
+/*Returns the size in bytes of a binary edit script, including its direction
+  byte and the zero byte that ends it.*/
+int32_t edit_script_size(char *edit_script){
+    struct edit_info edit;
+    int pos = 1;
+
+    while (next_edit(edit_script, &pos, &edit));
+    return pos + 1;
+}
+
+/*Reads the edit at position *pos of a binary edit script and moves pos past
+ *it.  If there is an edit to read, next_edit fills in "edit" and returns
+ *true.  Otherwise, pos is left on the byte that ends the script and next_edit
+ *returns false.
+ *
+ *edit->str points into the edit script itself, so reading a script never
+ *allocates; use edit_residue to get the residues of the edit.
  */
 bool next_edit(char *edit_script, int *pos, struct edit_info *edit){
-    if (edit->str != NULL) {
-        free(edit->str);
-        edit->str = NULL;
-    }
-    int edit_length = 0;
-    int i = 0;
-    if (isdigit(edit_script[(*pos)]) || edit_script[(*pos)] == '\0')
+    int p = *pos;
+    uint32_t code = get_varint(edit_script, &p);
+
+    if (code == 0)
         return false;
-    edit->is_subdel = edit_script[(*pos)++] == 's';
-    edit->last_dist = 0;
-    edit->str_length = 0;
-    while (isdigit(edit_script[(*pos)])) {
-        edit->last_dist *= 8; /*octal encoding*/
-        edit->last_dist += edit_script[(*pos)++] - '0';
+    code--;
+    edit->last_dist = (int)(code >> 4);
+    edit->is_subdel = (code & 8) != 0;
+    edit->form = (int)(code & 7);
+    switch (edit->form) {
+        case CB_EDIT_PACKED:
+            edit->str_length = (int)get_varint(edit_script, &p);
+            edit->str = edit_script + p;
+            p += (edit->str_length + 3) / 4;
+            break;
+        case CB_EDIT_RAW:
+            edit->str_length = (int)get_varint(edit_script, &p);
+            edit->str = edit_script + p;
+            p += edit->str_length;
+            break;
+        case CB_EDIT_GAPS:
+            edit->str_length = (int)get_varint(edit_script, &p);
+            break;
+        default:
+            edit->str_length = 1;
     }
-    while (isupper(edit_script[(*pos)+edit_length]) ||
-                   edit_script[(*pos)+edit_length] == '-')
-        edit_length++;
-    edit->str = malloc((edit_length+1)*sizeof(*edit_script));
-    assert(edit->str);
-    edit->str_length = edit_length;
-
-    while (isupper(edit_script[(*pos)]) || edit_script[(*pos)] == '-')
-        edit->str[i++] = edit_script[(*pos)++];
+    *pos = p;
     return true;
 }
 
-/*Takes in as input an edit script in ASCII format, a sequence to read, and
- *the length of the sequence and applies the edit script to the sequence to
- *produce a new sequence.
+/*Returns residue i of an edit read by next_edit.*/
+char edit_residue(struct edit_info *edit, int i){
+    switch (edit->form) {
+        case CB_EDIT_PACKED:
+            return "ACGT"[(edit->str[i/4] >> (6 - 2*(i%4))) & 3];
+        case CB_EDIT_RAW:
+            return edit->str[i];
+        case CB_EDIT_GAPS:
+            return '-';
+        default:
+            return "ACGT-"[edit->form];
+    }
+}
+
+/*Walks a binary edit script and returns checkpoints of the state of decoding
+ *it (see struct cb_link_checkpoint) at the first edit after every "interval"
+ *residues of the original sequence, so that decode_edit_script can start in
+ *the middle of a long link.  Sets *count to the number of checkpoints, and
+ *returns NULL if there are none or interval is not positive.
+ */
+struct cb_link_checkpoint *edit_script_checkpoints(char *edit_script,
+                                                   int32_t interval,
+                                                   int32_t *count){
+    struct cb_link_checkpoint *checkpoints = NULL;
+    struct edit_info edit;
+    int32_t coarse_pos = 0, original_pos = 0, last_edit_str_len = 0;
+    int32_t next_checkpoint = interval, capacity = 0;
+    int pos = 1, edit_pos = 1;
+    int i;
+
+    *count = 0;
+    if (interval <= 0)
+        return NULL;
+
+    while (next_edit(edit_script, &pos, &edit)) {
+        /*The positions are those of the decoder just before this edit.*/
+        if (original_pos >= next_checkpoint) {
+            if (*count == capacity) {
+                capacity = capacity == 0 ? 8 : 2 * capacity;
+                checkpoints = realloc(checkpoints,
+                                      capacity*sizeof(*checkpoints));
+                assert(checkpoints);
+            }
+            checkpoints[*count].script_pos = edit_pos;
+            checkpoints[*count].coarse_pos = coarse_pos;
+            checkpoints[*count].original_pos = original_pos;
+            checkpoints[*count].last_edit_str_len = last_edit_str_len;
+            (*count)++;
+            next_checkpoint = original_pos + interval;
+        }
+
+        coarse_pos += edit.last_dist - last_edit_str_len;
+        original_pos += edit.last_dist - last_edit_str_len;
+        for (i = 0; i < edit.str_length; i++)
+            if (edit_residue(&edit, i) != '-')
+                original_pos++;
+        if (edit.is_subdel)
+            coarse_pos += edit.str_length;
+        last_edit_str_len = edit.str_length;
+        edit_pos = pos;
+    }
+    return checkpoints;
+}
+
+/*Takes in as input a binary edit script, a sequence to read, and the length
+ *of the sequence and applies the edit script to the sequence to produce a new
+ *sequence.
  */
 char *read_edit_script(char *edit_script, char *orig, int length){
     int i;
-    struct edit_info *edit = edit_info_create();
+    struct edit_info edit;
     int orig_pos = 0, last_edit_str_len = 0; /*length of last edit str*/
     int current = 0;
     int script_pos = 1;
+    char c;
 
     char *str = malloc((2*length+1)*sizeof(*str));
     assert(str);
 
-    while (next_edit(edit_script, &script_pos, edit)) {
+    while (next_edit(edit_script, &script_pos, &edit)) {
         /*chunk after previous edit*/
-        for (i = 0; i < edit->last_dist - last_edit_str_len; i++)
+        for (i = 0; i < edit.last_dist - last_edit_str_len; i++)
             str[current++] = orig[orig_pos+i];
 
         /*update position in original string*/
-        orig_pos += edit->last_dist - last_edit_str_len;
+        orig_pos += edit.last_dist - last_edit_str_len;
 
         /*append replacement string in edit script; get rid of dashes*/
-        for (i = 0; i < edit->str_length; i++)
-            if (edit->str[i] != '-')
-                str[current++] = edit->str[i];
+        for (i = 0; i < edit.str_length; i++)
+            if ((c = edit_residue(&edit, i)) != '-')
+                str[current++] = c;
 
         /*skip subdel along original string*/
-        if (edit->is_subdel) orig_pos += edit->str_length;
+        if (edit.is_subdel) orig_pos += edit.str_length;
 
-        last_edit_str_len = edit->str_length;
+        last_edit_str_len = edit.str_length;
     }
     while (orig_pos < length)
         str[current++] = orig[orig_pos++];
@@ -290,10 +290,65 @@ char *read_edit_script(char *edit_script, char *orig, int length){
         str = string_revcomp(str_fwd, -1);
         free(str_fwd);
     }
-    edit_info_free(edit);
     return str;
 }
 
+/*Converts an edit script in the ASCII format used before binary edit
+ *scripts, in which each edit is an 'i' or 's', an octal distance from the
+ *previous edit and a run of residues, to a binary edit script.
+ */
+char *edit_script_from_ASCII(char *ascii){
+    char *edit_script = NULL;
+    char *residues;
+    int32_t size = 2, current = 1;
+    int pos, dist, length, pass;
+    bool is_subdel;
+
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            edit_script = malloc(size*sizeof(*edit_script));
+            assert(edit_script);
+            edit_script[0] = ascii[0];
+        }
+        pos = 1;
+        while (next_ASCII_edit(ascii, &pos, &dist, &is_subdel,
+                               &residues, &length)) {
+            if (pass == 0)
+                size += edit_size(dist, residues, length);
+            else
+                current = put_edit(edit_script, current, dist, is_subdel,
+                                   residues, length);
+        }
+    }
+    edit_script[current] = '\0';
+    return edit_script;
+}
+
+/*Converts a binary edit script to the ASCII format with octal distances,
+  which is easier to read when debugging.*/
+char *edit_script_to_ASCII(char *edit_script){
+    struct edit_info edit;
+    char *ascii;
+    int pos = 1, size = 2, current = 1;
+    int i;
+
+    while (next_edit(edit_script, &pos, &edit))
+        size += 1 + 11 + edit.str_length;
+
+    ascii = malloc(size*sizeof(*ascii));
+    assert(ascii);
+
+    ascii[0] = edit_script[0];
+    pos = 1;
+    while (next_edit(edit_script, &pos, &edit)) {
+        ascii[current++] = edit.is_subdel ? 's' : 'i';
+        current += sprintf(ascii + current, "%o", edit.last_dist);
+        for (i = 0; i < edit.str_length; i++)
+            ascii[current++] = edit_residue(&edit, i);
+    }
+    ascii[current] = '\0';
+    return ascii;
+}
 /*An implementation of decode_edit_script that is used in Po-Ru's C++ version
  *used in search for expanding coarse BLAST hits.
  *
@@ -306,16 +361,20 @@ char *read_edit_script(char *edit_script, char *orig, int length){
 void decode_edit_script(char *orig, int dest_len, int original_start,
                         struct cb_coarse *coarsedb,
                         struct cb_link_to_coarse *link){
-    int i = 0, i0 = 0, i1 = 0;
+    int i = 0, i0 = 0;
+    uint32_t i1 = 0;
     char *diff = link->diff;
-    struct fasta_seq *sequence = cb_coarse_read_fasta_seq(coarsedb,
-                                          link->coarse_seq_id);
     int coarse_pos;
     int last_edit_str_len;
-    struct edit_info *edit = edit_info_create();
-    int script_pos;
+    struct edit_info edit;
+    struct cb_link_checkpoint *checkpoint;
+    int script_pos, skipped;
+    char c;
 
-    char *residues = sequence->seq;
+    /*Only the residues of the coarse sequence from "base" to the end of the
+      link are read, so residues[i] is the residue at base+i.*/
+    char *residues;
+    int base;
 
     bool fwd = (diff[0] & ((char)0x7f)) == '0';
 
@@ -323,78 +382,94 @@ void decode_edit_script(char *orig, int dest_len, int original_start,
     if (diff[1] == '\0' && fwd) {
         int starting_i0 = -1;
         int last_i0 = -1;
+        base = link->coarse_start;
+        residues = cb_coarse_read_residues(coarsedb, link->coarse_seq_id,
+                                           base, link->coarse_end);
         i0 = link->original_start - original_start;
         for (i1 = link->coarse_start; i1 < link->coarse_end; i0++, i1++)
             if (0 <= i0 && i0 < dest_len) {
                 starting_i0 = (starting_i0 == -1 ? i0 : starting_i0);
                 last_i0 = i0;
-                orig[i0] = residues[i1];
+                orig[i0] = residues[i1-base];
             }
         /*If the link is from a reverse-complement match, convert the original
           string to its reverse complement.*/
-        fasta_free_seq(sequence);
-        edit_info_free(edit);
+        free(residues);
         return;
     }
 
     coarse_pos = link->coarse_start;
     last_edit_str_len = 0;
     script_pos = 1;
+    skipped = 0;
+
+    /*Skip the part of the script before the section we want to re-create if
+      the link has a checkpoint inside of it.*/
+    checkpoint = nearest_checkpoint(link, fwd ?
+                     original_start - (int)link->original_start :
+                     (int)link->original_end - (original_start+dest_len-1));
+    if (checkpoint != NULL) {
+        coarse_pos += checkpoint->coarse_pos;
+        last_edit_str_len = checkpoint->last_edit_str_len;
+        script_pos = checkpoint->script_pos;
+        skipped = checkpoint->original_pos;
+    }
+    base = coarse_pos;
+    residues = cb_coarse_read_residues(coarsedb, link->coarse_seq_id,
+                                       base, link->coarse_end + 1);
 
     /*We are decompressing a link from a forward match*/
     if (fwd) {
-        i0 = link->original_start - original_start;
-        while (next_edit(diff, &script_pos, edit)) {
+        i0 = link->original_start - original_start + skipped;
+        while (next_edit(diff, &script_pos, &edit)) {
             int x = 0, xmin = -i0, xmax = dest_len - i0;
 
             for (x = maximum(0, xmin);
-                 x < minimum(edit->last_dist-last_edit_str_len, xmax); x++)
-                orig[i0+x] = residues[x+coarse_pos];
+                 x < minimum(edit.last_dist-last_edit_str_len, xmax); x++)
+                orig[i0+x] = residues[x+coarse_pos-base];
 
-            i0 += edit->last_dist - last_edit_str_len;
-            coarse_pos += edit->last_dist - last_edit_str_len;
-            for (i = 0; i < edit->str_length; i++)
-                if (edit->str[i] != '-') {
+            i0 += edit.last_dist - last_edit_str_len;
+            coarse_pos += edit.last_dist - last_edit_str_len;
+            for (i = 0; i < edit.str_length; i++)
+                if ((c = edit_residue(&edit, i)) != '-') {
                     if (0 <= i0 && i0 < dest_len)
-                        orig[i0] = edit->str[i];
+                        orig[i0] = c;
                     i0++;
                 }
-            if (edit->is_subdel) coarse_pos += edit->str_length;
+            if (edit.is_subdel) coarse_pos += edit.str_length;
 
-            last_edit_str_len = edit->str_length;
+            last_edit_str_len = edit.str_length;
 
             if (i0 >= dest_len) {
-                edit_info_free(edit);
-                fasta_free_seq(sequence);
+                free(residues);
                 return;
             }
         }
     }
     else {
-        i0 = link->original_end - original_start;
-        while (next_edit(diff, &script_pos, edit)) {
+        i0 = link->original_end - original_start - skipped;
+        while (next_edit(diff, &script_pos, &edit)) {
             int x = 0, xmin = i0 - dest_len + 1, xmax = i0 + 1;
             for (x = maximum(0, xmin);
-                 x < minimum(edit->last_dist-last_edit_str_len, xmax); x++)
-                orig[i0-x] = base_complement(residues[x+coarse_pos]);
+                 x < minimum(edit.last_dist-last_edit_str_len, xmax); x++)
+                orig[i0-x] = base_complement(residues[x+coarse_pos-base]);
 
-            i0 -= edit->last_dist - last_edit_str_len;
-            coarse_pos += edit->last_dist - last_edit_str_len;
-            for (i = 0; i < edit->str_length; i++) {
-                if (edit->str[i] != '-') {
+            i0 -= edit.last_dist - last_edit_str_len;
+            coarse_pos += edit.last_dist - last_edit_str_len;
+            for (i = 0; i < edit.str_length; i++) {
+                if ((c = edit_residue(&edit, i)) != '-') {
                     if (0 <= i0 && i0 < dest_len)
-                        orig[i0] = base_complement(edit->str[i]);
+                        orig[i0] = base_complement(c);
                     i0--;
                 }
             }
 
-            if (edit->is_subdel) coarse_pos += edit->str_length;
+            if (edit.is_subdel) coarse_pos += edit.str_length;
 
-            last_edit_str_len = edit->str_length;
+            last_edit_str_len = edit.str_length;
 
             if (i0 < 0) {
-                edit_info_free(edit);
-                fasta_free_seq(sequence);
+                free(residues);
                 return;
             }
         }
@@ -403,12 +478,30 @@ void decode_edit_script(char *orig, int dest_len, int original_start,
         int dir = fwd ? 1 : -1;
         for (i1 = coarse_pos; i1 <= link->coarse_end; i1++) {
             if (0 <= i0 && i0 < dest_len)
-                orig[i0] = fwd ? residues[i1] : base_complement(residues[i1]);
+                orig[i0] = fwd ? residues[i1-base] :
+                                 base_complement(residues[i1-base]);
             i0 += dir;
         }
     }
-    edit_info_free(edit);
-    fasta_free_seq(sequence);
+    free(residues);
+}
+
+/*Returns the last checkpoint of a link at or before original_pos residues
+  into the link, or NULL if there is no such checkpoint.*/
+static struct cb_link_checkpoint *
+nearest_checkpoint(struct cb_link_to_coarse *link, int32_t original_pos)
+{
+    int32_t lo = 0, hi = link->num_checkpoints, mid;
+
+    /*Find the number of checkpoints at or before original_pos.*/
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (link->checkpoints[mid].original_pos <= original_pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo == 0 ? NULL : &link->checkpoints[lo - 1];
 }
 
 /*Takes in as input a string and returns a copy of the string with the '-'
@@ -431,3 +524,122 @@ char *no_dashes(char *sequence){
     n[bases] = '\0';
     return n;
 }
+
+/*Returns how the residues of an edit are stored: a single A, C, G, T or '-'
+  is stored in the form itself; longer runs are packed into two bits per
+  residue, stored as a count for runs of gaps, or copied as they are.*/
+static int32_t
+edit_form(char *residues, int32_t length)
+{
+    int32_t i, code;
+    bool acgt = true, gaps = true;
+
+    if (length == 1) {
+        if (residues[0] == '-')
+            return 4;
+        code = base_code(residues[0]);
+        return code >= 0 ? code : CB_EDIT_RAW;
+    }
+    for (i = 0; i < length; i++) {
+        acgt = acgt && base_code(residues[i]) >= 0;
+        gaps = gaps && residues[i] == '-';
+    }
+    if (gaps)
+        return CB_EDIT_GAPS;
+    return acgt ? CB_EDIT_PACKED : CB_EDIT_RAW;
+}
+
+/*Returns the number of bytes that put_edit writes for an edit.*/
+static int32_t
+edit_size(int32_t dist, char *residues, int32_t length)
+{
+    int32_t form = edit_form(residues, length);
+    int32_t size = varint_size((((uint32_t)dist << 4) | 15) + 1);
+
+    switch (form) {
+        case CB_EDIT_PACKED:
+            return size + varint_size((uint32_t)length) + (length + 3) / 4;
+        case CB_EDIT_RAW:
+            return size + varint_size((uint32_t)length) + length;
+        case CB_EDIT_GAPS:
+            return size + varint_size((uint32_t)length);
+        default:
+            return size;
+    }
+}
+
+/*Writes one edit to a binary edit script at buf[pos] and returns the position
+ *after it.  An edit starts with a varint holding the distance from the
+ *previous edit shifted left by four, with bit 3 set for a
+ *substitution/deletion and the form of the edit (see edit_form) in the low
+ *three bits, all plus one so that a zero byte can end the script.  Edits that
+ *are not a single residue then have a varint with their number of residues,
+ *followed by the residues four to a byte (first residue in the high bits) if
+ *packed, or one to a byte if raw.
+ */
+static int32_t
+put_edit(char *buf, int32_t pos, int32_t dist, bool is_subdel,
+         char *residues, int32_t length)
+{
+    int32_t i, form = edit_form(residues, length);
+
+    pos = put_varint(buf, pos, (((uint32_t)dist << 4) |
+                                (is_subdel ? 8 : 0) | (uint32_t)form) + 1);
+    switch (form) {
+        case CB_EDIT_PACKED:
+            pos = put_varint(buf, pos, (uint32_t)length);
+            for (i = 0; i < length; i++) {
+                if (i % 4 == 0)
+                    buf[pos + i/4] = (char)0;
+                buf[pos + i/4] |=
+                    (char)(base_code(residues[i]) << (6 - 2*(i%4)));
+            }
+            return pos + (length + 3) / 4;
+        case CB_EDIT_RAW:
+            pos = put_varint(buf, pos, (uint32_t)length);
+            for (i = 0; i < length; i++)
+                buf[pos++] = residues[i];
+            return pos;
+        case CB_EDIT_GAPS:
+            return put_varint(buf, pos, (uint32_t)length);
+        default:
+            return pos;
+    }
+}
+
+static int32_t
+base_code(char base)
+{
+    switch (base) {
+        case 'A': return 0;
+        case 'C': return 1;
+        case 'G': return 2;
+        case 'T': return 3;
+        default:  return -1;
+    }
+}
+
+/*Reads one edit of an ASCII edit script, starting at *pos, and moves pos past
+ *it.  *residues is set to point into the script.  Returns false if there are
+ *no more edits.
+ */
+static bool
+next_ASCII_edit(char *edit_script, int *pos, int *dist, bool *is_subdel,
+                char **residues, int *length)
+{
+    if (isdigit(edit_script[(*pos)]) || edit_script[(*pos)] == '\0')
+        return false;
+    *is_subdel = edit_script[(*pos)++] == 's';
+    *dist = 0;
+    while (isdigit(edit_script[(*pos)])) {
+        *dist *= 8; /*octal encoding*/
+        *dist += edit_script[(*pos)++] - '0';
+    }
+    *residues = edit_script + *pos;
+    *length = 0;
+    while (isupper(edit_script[(*pos)]) || edit_script[(*pos)] == '-') {
+        (*length)++;
+        (*pos)++;
+    }
+    return true;
+}
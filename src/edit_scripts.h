@@ -4,26 +4,36 @@
 #include "coarse.h"
 #include "link_to_coarse.h"
 
+/*The forms of the residues of an edit in a binary edit script.  Forms 0-4
+  are a single 'A', 'C', 'G', 'T' or '-'.*/
+#define CB_EDIT_PACKED 5
+#define CB_EDIT_RAW 6
+#define CB_EDIT_GAPS 7
+
+/*One edit of a binary edit script, as read by next_edit.  str points into the
+  script; use edit_residue to read the residues of the edit.*/
 struct edit_info{
     bool is_subdel;
+    int form;
     int last_dist;
     char *str;
     int str_length;
 };
 
-struct edit_info *edit_info_create();
-void edit_info_free(struct edit_info *edit);
-
-char to_half_byte(char c);
 char half_byte_to_char(char h);
-char *edit_script_to_half_bytes(char *edit_script);
 char *half_bytes_to_ASCII(char *half_bytes, int length);
-char *to_octal_str(int i);
 char *make_edit_script(char *str, char *ref, bool dir, int length);
+int32_t edit_script_size(char *edit_script);
+bool next_edit(char *edit_script, int *pos, struct edit_info *edit);
+char edit_residue(struct edit_info *edit, int i);
+struct cb_link_checkpoint *edit_script_checkpoints(char *edit_script,
+                                                   int32_t interval,
+                                                   int32_t *count);
 char *read_edit_script(char *edit_script, char *orig, int length);
+char *edit_script_from_ASCII(char *ascii);
+char *edit_script_to_ASCII(char *edit_script);
 void decode_edit_script(char *orig, int dest_len, int original_start,
                         struct cb_coarse *coarsedb,
                         struct cb_link_to_coarse *link);
-bool next_edit(char *edit_script, int *pos, struct edit_info *edit);
 char *no_dashes(char *sequence);
 #endif
@@ -5,33 +5,58 @@
 #include <string.h>
 
 #include "fasta.h"
-#include "util.h"
+
+/*The growing residues of a sequence being read.*/
+struct fasta_residues {
+    char *seq;
+    int64_t length;
+    int64_t allocated;
+};
 
 static bool
 is_new_sequence_start(FILE *f);
 
 static void
-exclude_residues(char *seq, const char *exclude);
+make_residue_map(char *map, const char *exclude);
+
+static char *
+header_name(const char *line, int32_t length);
+
+static void
+append_line(struct fasta_residues *residues, const char *line,
+            int32_t length, const char *map);
+
+static char *
+finish_residues(struct fasta_residues *residues);
+
+static int32_t
+read_file_line(FILE *f, char **line, int32_t *allocated);
+
+static int32_t
+reader_fill(struct fasta_reader *reader, int32_t length);
+
+static int
+reader_peek(struct fasta_reader *reader);
+
+static int32_t
+reader_line(struct fasta_reader *reader, char **line);
 
 static void *
 fasta_generator(void *gen);
 
+/*Reads every sequence in a FASTA file, which may be compressed with gzip or
+  bgzip, or is stdin if file_name is "-".  bgzip files are inflated with up to
+  "threads" threads.*/
 struct fasta_file *
-fasta_read_all(const char *file_name, const char *exclude)
+fasta_read_all(const char *file_name, const char *exclude, int32_t threads)
 {
-    FILE *f;
     struct fasta_file *ff;
     struct fasta_seq *new_seq;
+    struct fasta_reader *reader;
     int allocated = 0;
 
     printf("Reading all sequences from: %s\n", file_name);
 
-    f = fopen(file_name, "r");
-    if (f == NULL) {
-        perror("fasta_read_all");
-        exit(1);
-    }
-
     ff = malloc(sizeof(*ff));
     assert(ff);
     ff->length = 0;
@@ -40,7 +65,8 @@ fasta_read_all(const char *file_name, const char *exclude)
     ff->seqs = malloc(allocated * sizeof(*ff->seqs));
     assert(ff->seqs);
 
-    while (NULL != (new_seq = fasta_read_next(f, exclude))) {
+    reader = fasta_reader_open(file_name, exclude, threads);
+    while (NULL != (new_seq = fasta_reader_next(reader))) {
         if (ff->length == allocated) {
             allocated *= 1.5;
             ff->seqs = realloc(ff->seqs, allocated * sizeof(*ff->seqs));
@@ -49,57 +75,142 @@ fasta_read_all(const char *file_name, const char *exclude)
         ff->seqs[ff->length++] = new_seq;
     }
 
-    fclose(f);
+    fasta_reader_free(reader);
 
     return ff;
 }
 
+/*Reads the next sequence from a FASTA file, leaving f at the start of the
+ *sequence after it, or returns NULL if f is not at the start of a sequence.
+ *Use a struct fasta_reader to read every sequence in a file; this is for
+ *reading one sequence at a time from a file that is also used for other
+ *things.
+ */
 struct fasta_seq *
 fasta_read_next(FILE *f, const char *exclude)
 {
     struct fasta_seq *fs;
-    char *line = NULL;
+    struct fasta_residues residues;
+    char *line, map[256];
+    int32_t length, allocated;
 
     /* check to make sure the next line starts a new sequence record */
-    if (!is_new_sequence_start(f)){
-        return NULL;}
+    if (!is_new_sequence_start(f))
+        return NULL;
+
+    allocated = FASTA_MAX_LINE;
+    line = malloc(allocated * sizeof(*line));
+    assert(line);
 
     /* read in the sequence id */
-    if (0 == readline(f, &line)) {
+    if (0 == (length = read_file_line(f, &line, &allocated))) {
         free(line);
         return NULL;
     }
 
-    line = trim(line, "> \n\r\t");
-
     fs = malloc(sizeof(*fs));
     assert(fs);
-
-    fs->name = malloc((strlen(line) + 1) * sizeof(*fs->name));
-    assert(fs->name);
-    strcpy(fs->name, line);
-    free(line);
+    fs->name = header_name(line, length);
 
     /* Now read all of the sequence data for this record */
-    fs->seq = malloc(sizeof(*fs->seq));
-    assert(fs->seq);
-    fs->seq[0] = '\0';
+    make_residue_map(map, exclude);
+    residues.seq = NULL;
+    residues.length = 0;
+    residues.allocated = 0;
     while (!is_new_sequence_start(f)) {
-        if (0 == readline(f, &line)) {
-            free(line);
-            return fs;
-        }
+        if (0 == (length = read_file_line(f, &line, &allocated)))
+            break;
+        append_line(&residues, line, length, map);
+    }
+    fs->seq = finish_residues(&residues);
+
+    free(line);
+    return fs;
+}
 
-        line = trim(line, "* \n\r\t");
-        exclude_residues(line, exclude);
-        exclude_residues(line, "*");
+/*Creates a reader for the FASTA file fp, which is read from its current
+  position.  Residues in exclude are read as 'X'.*/
+struct fasta_reader *
+fasta_reader_init(FILE *fp, const char *exclude)
+{
+    struct fasta_reader *reader;
 
-        fs->seq = realloc(
-            fs->seq, sizeof(*fs->seq) * (1 + strlen(line) + strlen(fs->seq)));
-        assert(fs->seq);
-        strcat(fs->seq, line);
-        free(line);
+    reader = malloc(sizeof(*reader));
+    assert(reader);
+
+    reader->size = FASTA_BUFFER_SIZE;
+    reader->buf = malloc(reader->size * sizeof(*reader->buf));
+    assert(reader->buf);
+
+    reader->fp = fp;
+    reader->zf = NULL;
+    reader->pos = 0;
+    reader->end = 0;
+    reader->eof = false;
+    make_residue_map(reader->map, exclude);
+
+    return reader;
+}
+
+/*Creates a reader for the FASTA file called file_name, or for stdin if
+ *file_name is "-".  The file is read as it is inflated if it is compressed
+ *with gzip or bgzip, and bgzip files are inflated with up to "threads"
+ *threads.  The file is closed when the reader is freed.
+ */
+struct fasta_reader *
+fasta_reader_open(const char *file_name, const char *exclude,
+                  int32_t threads)
+{
+    struct fasta_reader *reader;
+
+    reader = fasta_reader_init(NULL, exclude);
+    reader->zf = cb_zfile_open(file_name, threads);
+
+    return reader;
+}
+
+/*Frees a reader.  A file opened by fasta_reader_open is closed, but a file
+  passed to fasta_reader_init is not.*/
+void
+fasta_reader_free(struct fasta_reader *reader)
+{
+    if (reader->zf != NULL)
+        cb_zfile_close(reader->zf);
+    free(reader->buf);
+    free(reader);
+}
+
+/*Reads the next sequence from a FASTA file, or returns NULL at the end of the
+ *file or if the reader is not at the start of a sequence.  Lines are found
+ *with memchr in the reader's buffer and residues are copied through the
+ *reader's map into a buffer that doubles in size as it fills, so the cost is
+ *linear in the size of the sequence.
+ */
+struct fasta_seq *
+fasta_reader_next(struct fasta_reader *reader)
+{
+    struct fasta_seq *fs;
+    struct fasta_residues residues;
+    char *line;
+    int32_t length;
+
+    if (reader_peek(reader) != '>')
+        return NULL;
+
+    length = reader_line(reader, &line);
+
+    fs = malloc(sizeof(*fs));
+    assert(fs);
+    fs->name = header_name(line, length);
+
+    residues.seq = NULL;
+    residues.length = 0;
+    residues.allocated = 0;
+    while (reader_peek(reader) != '>' && reader_peek(reader) != EOF) {
+        length = reader_line(reader, &line);
+        append_line(&residues, line, length, reader->map);
     }
+    fs->seq = finish_residues(&residues);
 
     return fs;
 }
@@ -125,24 +236,18 @@ fasta_free_seq(struct fasta_seq *seq)
 
 struct fasta_seq_gen *
 fasta_generator_start(const char *file_name, const char *exclude,
-                      int buffer_capacity)
+                      int buffer_capacity, int32_t threads)
 {
-    FILE *fp;
     struct fasta_seq_gen *fsg;
     int errno;
 
     assert(buffer_capacity > 0);
 
-    if (NULL == (fp = fopen(file_name, "r"))) {
-        perror("fasta_start_generator");
-        exit(1);
-    }
-
     fsg = malloc(sizeof(*fsg));
     assert(fsg);
 
     fsg->seqs = ds_queue_create(buffer_capacity);
-    fsg->fp = fp;
+    fsg->reader = fasta_reader_open(file_name, exclude, threads);
     fsg->exclude = exclude;
 
     errno = pthread_create(&fsg->thread, NULL, fasta_generator, (void*) fsg);
@@ -163,7 +268,7 @@ fasta_generator_free(struct fasta_seq_gen *fsg)
         fprintf(stderr, "Could not join thread. Errno: %d\n", errno);
         exit(1);
     }
-    fclose(fsg->fp);
+    fasta_reader_free(fsg->reader);
     ds_queue_free(fsg->seqs);
     free(fsg);
 }
@@ -176,7 +281,7 @@ fasta_generator(void *gen)
 
     fsg = (struct fasta_seq_gen *) gen;
 
-    while (NULL != (seq = fasta_read_next(fsg->fp, fsg->exclude))) {
+    while (NULL != (seq = fasta_reader_next(fsg->reader))) {
         ds_queue_put(fsg->seqs, seq);
     }
 
@@ -210,13 +315,167 @@ is_new_sequence_start(FILE *f)
     return is_new_seq;
 }
 
+/*Fills map so that residues in exclude and '*' are read as 'X' and every
+  other byte is read as itself.*/
+static void
+make_residue_map(char *map, const char *exclude)
+{
+    int i;
+
+    for (i = 0; i < 256; i++)
+        map[i] = (char)i;
+    for (i = 0; exclude[i] != '\0'; i++)
+        map[(unsigned char)exclude[i]] = 'X';
+    map['*'] = 'X';
+}
+
+/*Returns a new copy of the name in a header line, without the '>' and the
+  spaces around it.*/
+static char *
+header_name(const char *line, int32_t length)
+{
+    int32_t start = 0, end = length;
+    char *name;
+
+    while (start < end && strchr("> \n\r\t", line[start]) != NULL)
+        start++;
+    while (end > start && strchr("> \n\r\t", line[end-1]) != NULL)
+        end--;
+
+    name = malloc((end - start + 1) * sizeof(*name));
+    assert(name);
+    memcpy(name, line + start, end - start);
+    name[end-start] = '\0';
+
+    return name;
+}
+
+/*Appends the residues on a line of a sequence, without the spaces and '*'s
+  at either end of the line.*/
 static void
-exclude_residues(char *seq, const char *exclude)
+append_line(struct fasta_residues *residues, const char *line,
+            int32_t length, const char *map)
+{
+    int32_t start = 0, end = length, i;
+    char *seq;
+
+    while (start < end && strchr("* \n\r\t", line[start]) != NULL)
+        start++;
+    while (end > start && strchr("* \n\r\t", line[end-1]) != NULL)
+        end--;
+
+    if (residues->length + (end - start) + 1 > residues->allocated) {
+        residues->allocated = residues->allocated == 0 ?
+                              FASTA_INITIAL_SEQUENCE_LENGTH :
+                              2 * residues->allocated;
+        if (residues->allocated < residues->length + (end - start) + 1)
+            residues->allocated = residues->length + (end - start) + 1;
+        residues->seq = realloc(residues->seq,
+                                residues->allocated * sizeof(*residues->seq));
+        assert(residues->seq);
+    }
+
+    seq = residues->seq + residues->length;
+    for (i = start; i < end; i++)
+        *seq++ = map[(unsigned char)line[i]];
+    residues->length += end - start;
+}
+
+/*Returns the residues of a sequence that has been read as a string, shrunk to
+  fit.*/
+static char *
+finish_residues(struct fasta_residues *residues)
+{
+    char *seq;
+
+    seq = realloc(residues->seq, (residues->length + 1) * sizeof(*seq));
+    assert(seq);
+    seq[residues->length] = '\0';
+    return seq;
+}
+
+/*Reads a line from f into *line, which has room for *allocated characters and
+  is made bigger as needed, and returns its length, or 0 at the end of f.*/
+static int32_t
+read_file_line(FILE *f, char **line, int32_t *allocated)
+{
+    int32_t length = 0;
+
+    while (NULL != fgets(*line + length, *allocated - length, f)) {
+        length += strlen(*line + length);
+        if ((*line)[length-1] == '\n')
+            break;
+        if (length == *allocated - 1) {
+            *allocated *= 2;
+            *line = realloc(*line, *allocated * sizeof(**line));
+            assert(*line);
+        }
+    }
+    return length;
+}
+
+/*Reads up to length bytes into a reader's buffer after its end and returns the
+  number of bytes read, which is less than length only at the end of the
+  file.*/
+static int32_t
+reader_fill(struct fasta_reader *reader, int32_t length)
+{
+    if (reader->zf != NULL)
+        return cb_zfile_read(reader->zf, reader->buf + reader->end, length);
+    return fread(reader->buf + reader->end, sizeof(*reader->buf), length,
+                 reader->fp);
+}
+
+/*Returns the next byte of a reader's file without moving past it, or EOF.*/
+static int
+reader_peek(struct fasta_reader *reader)
 {
-    int i, j;
+    if (reader->pos == reader->end && !reader->eof) {
+        reader->pos = 0;
+        reader->end = 0;
+        reader->end = reader_fill(reader, reader->size);
+        reader->eof = reader->end < reader->size;
+    }
+    return reader->pos == reader->end ? EOF :
+                                        (unsigned char)reader->buf[reader->pos];
+}
+
+/*Points *line at the next line in a reader's buffer, including its newline,
+ *and moves past it.  Returns the length of the line, or 0 at the end of the
+ *file.  The line is only valid until the next call.
+ */
+static int32_t
+reader_line(struct fasta_reader *reader, char **line)
+{
+    char *newline;
+    int32_t length, scanned = 0;
+
+    while (NULL == (newline = memchr(reader->buf + reader->pos + scanned, '\n',
+                                     reader->end - reader->pos - scanned)) &&
+             !reader->eof) {
+        scanned = reader->end - reader->pos;
+
+        /*Move the part of the line that has been read to the start of the
+          buffer, or make the buffer bigger if the line fills all of it.*/
+        if (reader->pos > 0) {
+            memmove(reader->buf, reader->buf + reader->pos, scanned);
+            reader->pos = 0;
+            reader->end = scanned;
+        }
+        else if (reader->end == reader->size) {
+            reader->size *= 2;
+            reader->buf = realloc(reader->buf,
+                                  reader->size * sizeof(*reader->buf));
+            assert(reader->buf);
+        }
+        length = reader_fill(reader, reader->size - reader->end);
+        reader->eof = length < reader->size - reader->end;
+        reader->end += length;
+    }
 
-    for (i = 0; seq[i] != '\0'; i++)
-        for (j = 0; exclude[j] != '\0'; j++)
-            if (seq[i] == exclude[j])
-                seq[i] = 'X';
+    *line = reader->buf + reader->pos;
+    length = newline == NULL ? reader->end - reader->pos :
+                               newline - *line + 1;
+    reader->pos += length;
+    return length;
 }
@@ -8,8 +8,11 @@
 
 #include "ds.h"
 
+#include "zfile.h"
+
 #define FASTA_INITIAL_SEQUENCE_LENGTH 1000
 #define FASTA_MAX_LINE 1024
+#define FASTA_BUFFER_SIZE (1 << 20)
 #define FASTA_EXCLUDE_NCBI_BLOSUM62 "JOU"
 
 struct fasta_file {
@@ -22,19 +25,51 @@ struct fasta_seq {
     char *seq;
 };
 
+/*A FASTA file read in large blocks.  The bytes of buf from pos up to end have
+ *been read but not parsed yet; a line is only parsed once all of it is in buf,
+ *so buf grows for lines longer than it.  map gives the residue each byte of a
+ *sequence is stored as, which is 'X' for excluded residues and '*'.
+ *
+ *A reader made by fasta_reader_open reads zf, which may be compressed with
+ *gzip or bgzip; otherwise it reads fp.
+ */
+struct fasta_reader {
+    FILE *fp;
+    struct cb_zfile *zf;
+    char *buf;
+    int32_t size;
+    int32_t pos;
+    int32_t end;
+    bool eof;
+    char map[256];
+};
+
 struct fasta_seq_gen {
     pthread_t thread;
-    FILE *fp;
+    struct fasta_reader *reader;
     struct DSQueue *seqs;
     const char *exclude;
 };
 
 struct fasta_file *
-fasta_read_all(const char *file_name, const char *exclude);
+fasta_read_all(const char *file_name, const char *exclude, int32_t threads);
 
 struct fasta_seq *
 fasta_read_next(FILE *f, const char *exclude);
 
+struct fasta_reader *
+fasta_reader_init(FILE *fp, const char *exclude);
+
+struct fasta_reader *
+fasta_reader_open(const char *file_name, const char *exclude,
+                  int32_t threads);
+
+void
+fasta_reader_free(struct fasta_reader *reader);
+
+struct fasta_seq *
+fasta_reader_next(struct fasta_reader *reader);
+
 void
 fasta_free_all(struct fasta_file *ff);
 
@@ -43,7 +78,7 @@ fasta_free_seq(struct fasta_seq *seq);
 
 struct fasta_seq_gen *
 fasta_generator_start(const char *file_name, const char *exclude,
-                      int buffer_capacity);
+                      int buffer_capacity, int32_t threads);
 
 void
 fasta_generator_free(struct fasta_seq_gen *fsg);
@@ -32,6 +32,10 @@ load_compress_args()
     opt_flag_int(conf,
         &compress_flags.procs, "procs", cpus,
         "The number of total CPUs to use to divide work.");
+    opt_flag_int(conf,
+        &compress_flags.read_procs, "read-procs", 4,
+        "The number of FASTA files to read at once. Sequences are still "
+        "given IDs in the order the files are listed.");
     opt_flag_int(conf,
         &compress_flags.map_seed_size, "map-seed-size", 10,
         "The size of a seed in the K-mer map. This size combined with "
@@ -83,11 +87,72 @@ load_compress_args()
         &compress_flags.attempt_ext_len, "attempt-ext-len", 50,
         "The minimum total length of an extension after running attempt_ext in "
         "both directions needed to call extend_match.");
+    opt_flag_int(conf,
+        &compress_flags.max_seed_skip, "max-seed-skip", 8,
+        "The maximum number of bases to skip between seed lookups while no "
+        "seed hits are being found. The skip doubles after each position "
+        "with no seed locations and drops back to 1 as soon as a seed gets "
+        "through attempt_ext. A value of 1 looks up a seed at every base.");
+    opt_flag_int(conf,
+        &compress_flags.dust_level, "dust-level", 20,
+        "The DUST score (times 10) above which a window is considered "
+        "low-complexity. Seeds touching a low-complexity window are neither "
+        "added to the seeds table nor looked up. 0 disables masking.");
+    opt_flag_int(conf,
+        &compress_flags.dust_window, "dust-window", 64,
+        "The size of the window scored for low-complexity masking.");
+    opt_flag_int(conf,
+        &compress_flags.checkpoint_interval, "checkpoint-interval", 0,
+        "Save a checkpoint in each edit script every this many bases, so that "
+        "search can expand a hit in a long link without decoding the whole "
+        "link. Checkpoints make compressed.cb larger. 0 disables them.");
+    opt_flag_bool(conf,
+        &compress_flags.print_compress_stats, "print-compress-stats",
+        "Activate to print seed lookup statistics (probes per base and bases "
+        "skipped) once all sequences have been compressed.");
+    opt_flag_bool(conf,
+        &compress_flags.no_dedup, "no-dedup",
+        "Activate to run every sequence through seed extension and alignment, "
+        "even when it or one of its chunks is an exact copy of something "
+        "already in the database.");
 
     return conf;
 }
 
 
+struct opt_config *
+load_decompress_args()
+{
+    struct opt_config *conf;
+    int32_t cpus;
+
+    conf = opt_config_init();
+    cpus = num_cpus();
+
+    opt_flag_int(conf,
+        &decompress_flags.procs, "procs", cpus,
+        "The number of threads to decompress sequences with.");
+    opt_flag_string(conf,
+        &decompress_flags.ids, "ids", "",
+        "A comma-separated list of the IDs of sequences to decompress, in the "
+        "order to write them. IDs start at 0 and are in the headers of "
+        "decompressed sequences.");
+    opt_flag_string(conf,
+        &decompress_flags.names, "names", "",
+        "A comma-separated list of the names of sequences to decompress. A "
+        "name is a FASTA header up to its first space. Names are looked up "
+        "in compressed.cb.names, which is made the first time it is needed "
+        "for databases that do not have one.");
+    opt_flag_string(conf,
+        &decompress_flags.region, "region", "",
+        "A comma-separated list of regions to decompress, each written as "
+        "name:start-end with 1-based, inclusive coordinates. Regions are cut "
+        "short at the end of their sequence. Only the links that overlap a "
+        "region are decoded.");
+
+    return conf;
+}
+
 struct opt_config *
 load_search_args()
 {
@@ -106,6 +171,19 @@ load_search_args()
         "The e-value used during coarse search.  To set the e-value for fine "
         "search, add it as an argument in --blast-args, which is the list of "
         "arguments to pass into BLAST during fine search.");
+    opt_flag_int(conf,
+        &search_flags.coarse_cache_size, "coarse-cache-size", 64,
+        "The number of megabytes of coarse sequences to keep in memory while "
+        "expanding coarse BLAST hits, so that coarse sequences linked to by "
+        "many hits are only read once. 0 disables the cache.");
+    opt_flag_int(conf,
+        &search_flags.compressed_cache_size, "compressed-cache-size", 64,
+        "The number of megabytes of compressed sequences to keep in memory "
+        "while expanding coarse BLAST hits, so that original sequences hit "
+        "many times are only read once. 0 disables the cache.");
+    opt_flag_int(conf,
+        &search_flags.procs, "procs", cpus,
+        "The number of threads to expand coarse BLAST hits with.");
     opt_flag_bool(conf,
         &search_flags.no_cleanup, "no-cleanup",
         "Activate to keep the coarse search results XML file, the fine "
@@ -14,6 +14,7 @@ struct compress_flags {
     int32_t match_seq_id_threshold;
     int32_t min_match_len;
     int32_t procs;
+    int32_t read_procs;
     int32_t map_seed_size;
     int32_t ext_seed_size;
     int32_t ext_seq_id_threshold;
@@ -27,11 +28,27 @@ struct compress_flags {
     int32_t btwn_match_min_dist_check;
     float   btwn_match_ident_thresh;
     int32_t attempt_ext_len;
+    int32_t max_seed_skip;
+    int32_t dust_level;
+    int32_t dust_window;
+    int32_t checkpoint_interval;
+    bool    print_compress_stats;
+    bool    no_dedup;
 } compress_flags;
 
+struct decompress_flags {
+    int32_t procs;
+    char    *ids;
+    char    *names;
+    char    *region;
+} decompress_flags;
+
 struct search_flags {
     int32_t map_seed_size;
     char    *coarse_evalue;
+    int32_t coarse_cache_size;
+    int32_t compressed_cache_size;
+    int32_t procs;
     bool    no_cleanup;
     bool    hide_messages;
 } search_flags;
@@ -40,6 +57,9 @@ struct search_flags {
 struct opt_config *
 load_compress_args();
 
+struct opt_config *
+load_decompress_args();
+
 struct opt_config *
 load_search_args();
 
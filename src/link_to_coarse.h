@@ -3,13 +3,29 @@
 
 #include <stdint.h>
 
+/*The state of decoding a link's edit script just before the edit at
+ *script_pos.  coarse_pos is relative to the link's coarse_start, and
+ *original_pos is the number of residues of the original sequence decoded so
+ *far (counting from original_end instead of original_start for links from
+ *reverse-complement matches).  last_edit_str_len is the length of the edit
+ *before script_pos.
+ */
+struct cb_link_checkpoint {
+    int32_t script_pos;
+    int32_t coarse_pos;
+    int32_t original_pos;
+    int32_t last_edit_str_len;
+};
+
 struct cb_link_to_coarse {
     char *diff;
-    uint16_t coarse_seq_id;
+    struct cb_link_checkpoint *checkpoints;
+    int32_t num_checkpoints;
+    uint32_t coarse_seq_id;
     uint64_t original_start;
     uint64_t original_end;
-    uint16_t coarse_start;
-    uint16_t coarse_end;
+    uint32_t coarse_start;
+    uint32_t coarse_end;
     struct cb_link_to_coarse *next;
 };
 #endif
@@ -7,8 +7,8 @@
 struct cb_link_to_compressed {
     bool dir;
     int32_t org_seq_id;
-    int16_t coarse_start;
-    int16_t coarse_end;
+    int32_t coarse_start;
+    int32_t coarse_end;
     uint64_t original_start;
     uint64_t original_end;
     struct cb_link_to_compressed *next;
@@ -0,0 +1,309 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bitpack.h"
+#include "coarse.h"
+#include "links_file.h"
+
+/*A node of the implicit tree of a coarse sequence's links still to be
+  searched: the entry at position x and level k, and whether its left subtree
+  has been searched yet.*/
+struct links_node {
+    int64_t x;
+    int32_t k;
+    bool left_done;
+};
+
+static int
+compare_links(const void *a, const void *b);
+
+static void
+index_max_ends(struct cb_link_to_compressed **links, int32_t num_links,
+               int32_t *max_ends);
+
+static struct cb_link_to_compressed *
+entry_link(unsigned char *entry);
+
+static int32_t
+entry_int(unsigned char *entries, int64_t i, int32_t field);
+
+static int32_t
+get_int(unsigned char *p);
+
+/*Outputs the links of a coarse sequence to a coarse.links file in the format
+  described in links_file.h.*/
+void
+cb_links_file_write(struct cb_link_to_compressed *links, struct cb_writer *f)
+{
+    struct cb_link_to_compressed *link, **sorted;
+    int32_t num_links = 0, *max_ends, i;
+
+    for (link = links; link != NULL; link = link->next)
+        num_links++;
+
+    sorted = malloc(num_links*sizeof(*sorted));
+    assert(sorted);
+    max_ends = malloc(num_links*sizeof(*max_ends));
+    assert(max_ends);
+    for (i = 0, link = links; link != NULL; i++, link = link->next)
+        sorted[i] = link;
+    qsort(sorted, num_links, sizeof(*sorted), compare_links);
+    index_max_ends(sorted, num_links, max_ends);
+
+    cb_writer_int(f, (uint64_t)num_links, 4);
+    for (i = 0; i < num_links; i++) {
+        link = sorted[i];
+        cb_writer_int(f, (uint64_t)link->org_seq_id, 4);
+        cb_writer_int(f, (uint64_t)link->coarse_start, 4);
+        cb_writer_int(f, (uint64_t)link->coarse_end, 4);
+        cb_writer_int(f, (uint64_t)max_ends[i], 4);
+        cb_writer_int(f, link->original_start, 4);
+        cb_writer_int(f, link->original_end, 4);
+        cb_writer_char(f, link->dir ? 1 : 0);
+    }
+
+    free(sorted);
+    free(max_ends);
+}
+
+/*Reads the links of the coarse sequence that f points to in a coarse.links
+  file, in order of coarse start.  Returns NULL at the end of the file.*/
+struct DSVector *
+cb_links_file_read(FILE *f)
+{
+    struct DSVector *links;
+    unsigned char *entries;
+    int32_t num_links, i;
+
+    num_links = (int32_t)read_int_from_file(4, f);
+    if (feof(f))
+        return NULL;
+
+    entries = malloc(((int64_t)num_links*CABLAST_LINKS_FILE_ENTRY_SIZE + 1)*
+                     sizeof(*entries));
+    assert(entries);
+    if (fread(entries, CABLAST_LINKS_FILE_ENTRY_SIZE, num_links, f) !=
+          (size_t)num_links) {
+        free(entries);
+        return NULL;
+    }
+
+    links = ds_vector_create();
+    for (i = 0; i < num_links; i++)
+        ds_vector_append(links, (void *)entry_link(
+                             entries + (int64_t)i*CABLAST_LINKS_FILE_ENTRY_SIZE));
+    free(entries);
+    return links;
+}
+
+/*Maps a coarse.links file for reading, or returns NULL if f is NULL or is not
+  a coarse.links file in the current format, in which case the links have to
+  be read through the FILE pointer.*/
+struct cb_links_file *
+cb_links_file_init(FILE *f)
+{
+    struct cb_links_file *links_file;
+    struct stat buf;
+    unsigned char *bytes;
+    int32_t i;
+    void *map;
+
+    if (f == NULL || 0 != fstat(fileno(f), &buf) || buf.st_size < 8)
+        return NULL;
+
+    map = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    bytes = (unsigned char *)map;
+
+    for (i = 0; CABLAST_COARSE_LINKS_MAGIC[i] != '\0'; i++)
+        if (bytes[i] != (unsigned char)CABLAST_COARSE_LINKS_MAGIC[i])
+            break;
+    if (CABLAST_COARSE_LINKS_MAGIC[i] != '\0' ||
+          bytes[i] != CABLAST_COARSE_LINKS_VERSION) {
+        munmap(map, buf.st_size);
+        return NULL;
+    }
+
+    links_file = malloc(sizeof(*links_file));
+    assert(links_file);
+
+    links_file->bytes = bytes;
+    links_file->length = buf.st_size;
+
+    return links_file;
+}
+
+void
+cb_links_file_free(struct cb_links_file *links_file)
+{
+    if (links_file == NULL)
+        return;
+    munmap(links_file->bytes, links_file->length);
+    free(links_file);
+}
+
+/*Returns the links of the coarse sequence at offset in a mapped coarse.links
+ *file whose coarse ranges overlap the range from "from" to "to" (both
+ *inclusive), in order of coarse start.  The tree of the sequence's links is
+ *searched from the root; a left subtree is skipped if nothing in it ends at
+ *or after from, and a right subtree if its entry starts after to.  Small
+ *subtrees are scanned in order instead.
+ */
+struct DSVector *
+cb_links_file_overlapping(struct cb_links_file *links_file, int64_t offset,
+                          int32_t from, int32_t to)
+{
+    struct DSVector *links = ds_vector_create();
+    struct links_node stack[64], z;
+    unsigned char *entries, *entry;
+    int64_t num_links, i, end, left;
+    int32_t top = 0, root = 0;
+
+    if (offset < 0 || offset + 4 > links_file->length)
+        return links;
+    num_links = get_int(links_file->bytes + offset);
+    entries = links_file->bytes + offset + 4;
+    if (num_links == 0 ||
+          offset + 4 + num_links*CABLAST_LINKS_FILE_ENTRY_SIZE >
+          links_file->length)
+        return links;
+
+    while (((int64_t)1 << (root + 1)) <= num_links)
+        root++;
+    stack[top].x = ((int64_t)1 << root) - 1;
+    stack[top].k = root;
+    stack[top++].left_done = false;
+
+    while (top > 0) {
+        z = stack[--top];
+        if (z.k <= 3) {
+            i = z.x >> z.k << z.k;
+            end = i + ((int64_t)1 << (z.k + 1)) - 1;
+            if (end > num_links)
+                end = num_links;
+            for (; i < end && entry_int(entries, i, 4) <= to; i++)
+                if (entry_int(entries, i, 8) >= from) {
+                    entry = entries + i*CABLAST_LINKS_FILE_ENTRY_SIZE;
+                    ds_vector_append(links, (void *)entry_link(entry));
+                }
+        }
+        else if (!z.left_done) {
+            /*Nodes past the end of the entries stand in for the missing
+              right side of the tree, so the left child can be one of them.*/
+            left = z.x - ((int64_t)1 << (z.k - 1));
+            stack[top] = z;
+            stack[top++].left_done = true;
+            if (left >= num_links || entry_int(entries, left, 12) >= from) {
+                stack[top].x = left;
+                stack[top].k = z.k - 1;
+                stack[top++].left_done = false;
+            }
+        }
+        else if (z.x < num_links && entry_int(entries, z.x, 4) <= to) {
+            if (entry_int(entries, z.x, 8) >= from) {
+                entry = entries + z.x*CABLAST_LINKS_FILE_ENTRY_SIZE;
+                ds_vector_append(links, (void *)entry_link(entry));
+            }
+            stack[top].x = z.x + ((int64_t)1 << (z.k - 1));
+            stack[top].k = z.k - 1;
+            stack[top++].left_done = false;
+        }
+    }
+
+    return links;
+}
+
+/*Orders links by coarse start, then by coarse end, original sequence ID and
+  original start.*/
+static int
+compare_links(const void *a, const void *b)
+{
+    const struct cb_link_to_compressed *x =
+        *(struct cb_link_to_compressed **)a;
+    const struct cb_link_to_compressed *y =
+        *(struct cb_link_to_compressed **)b;
+
+    if (x->coarse_start != y->coarse_start)
+        return x->coarse_start < y->coarse_start ? -1 : 1;
+    if (x->coarse_end != y->coarse_end)
+        return x->coarse_end < y->coarse_end ? -1 : 1;
+    if (x->org_seq_id != y->org_seq_id)
+        return x->org_seq_id < y->org_seq_id ? -1 : 1;
+    if (x->original_start != y->original_start)
+        return x->original_start < y->original_start ? -1 : 1;
+    return 0;
+}
+
+/*Sets max_ends[i] to the greatest coarse end in the subtree of links[i] in
+ *the implicit tree over the sorted links.  The rightmost subtree at each level
+ *can be missing its right child; "last" is the greatest end in the subtree
+ *that takes its place, which is the subtree of the last node found so far.
+ */
+static void
+index_max_ends(struct cb_link_to_compressed **links, int32_t num_links,
+               int32_t *max_ends)
+{
+    int64_t i, last_i = 0, x;
+    int32_t last = 0, right, k;
+
+    for (i = 0; i < num_links; i += 2) {
+        last_i = i;
+        last = max_ends[i] = links[i]->coarse_end;
+    }
+    for (k = 1; ((int64_t)1 << k) <= num_links; k++) {
+        x = (int64_t)1 << (k - 1);
+        for (i = 2*x - 1; i < num_links; i += 4*x) {
+            max_ends[i] = links[i]->coarse_end;
+            if (max_ends[i - x] > max_ends[i])
+                max_ends[i] = max_ends[i - x];
+            right = i + x < num_links ? max_ends[i + x] : last;
+            if (right > max_ends[i])
+                max_ends[i] = right;
+        }
+        /*Move last_i up to its parent.*/
+        last_i = (last_i >> k & 1) ? last_i - x : last_i + x;
+        if (last_i < num_links && max_ends[last_i] > last)
+            last = max_ends[last_i];
+    }
+}
+
+/*Returns a new link with the contents of an entry in coarse.links.*/
+static struct cb_link_to_compressed *
+entry_link(unsigned char *entry)
+{
+    struct cb_link_to_compressed *link;
+
+    link = malloc(sizeof(*link));
+    assert(link);
+
+    link->org_seq_id = get_int(entry);
+    link->coarse_start = get_int(entry + 4);
+    link->coarse_end = get_int(entry + 8);
+    link->original_start = (uint32_t)get_int(entry + 16);
+    link->original_end = (uint32_t)get_int(entry + 20);
+    link->dir = entry[24] != 0;
+    link->next = NULL;
+
+    return link;
+}
+
+/*Returns the integer at byte "field" of entry i.*/
+static int32_t
+entry_int(unsigned char *entries, int64_t i, int32_t field)
+{
+    return get_int(entries + i*CABLAST_LINKS_FILE_ENTRY_SIZE + field);
+}
+
+static int32_t
+get_int(unsigned char *p)
+{
+    return (int32_t)(((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+                     ((uint32_t)p[2] << 8) | (uint32_t)p[3]);
+}
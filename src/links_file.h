@@ -0,0 +1,51 @@
+#ifndef __CABLAST_LINKS_FILE_H__
+#define __CABLAST_LINKS_FILE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ds.h"
+
+#include "link_to_compressed.h"
+#include "writer.h"
+
+/*In coarse.links, the links of each coarse sequence are a 4-byte count
+ *followed by one CABLAST_LINKS_FILE_ENTRY_SIZE-byte entry per link, sorted by
+ *coarse start: the original sequence ID, the coarse start, the coarse end,
+ *the greatest coarse end in the entry's subtree (see below), the original
+ *start and the original end, each a 4-byte integer, and then a byte with the
+ *direction of the link.  All integers are big-endian, so the file can be
+ *mapped and searched without being parsed.
+ *
+ *The sorted entries form an implicit balanced binary tree: entries at even
+ *positions are leaves, and the entry at position i is at level k if the
+ *lowest k bits of i are 1 and the next one is 0, with children at
+ *i - 2^(k-1) and i + 2^(k-1).  Each entry stores the greatest coarse end in
+ *its subtree, so the links that overlap a range of the coarse sequence are
+ *found without looking at the subtrees that end before it.
+ */
+#define CABLAST_LINKS_FILE_ENTRY_SIZE 25
+
+/*A read-only memory map of a coarse.links file.*/
+struct cb_links_file {
+    unsigned char *bytes;
+    int64_t length;
+};
+
+void
+cb_links_file_write(struct cb_link_to_compressed *links, struct cb_writer *f);
+
+struct DSVector *
+cb_links_file_read(FILE *f);
+
+struct cb_links_file *
+cb_links_file_init(FILE *f);
+
+void
+cb_links_file_free(struct cb_links_file *links_file);
+
+struct DSVector *
+cb_links_file_overlapping(struct cb_links_file *links_file, int64_t offset,
+                          int32_t from, int32_t to);
+
+#endif
@@ -0,0 +1,145 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "lru.h"
+
+static void
+unlink_entry(struct cb_lru *lru, struct cb_lru_entry *entry);
+
+static void
+push_entry(struct cb_lru *lru, struct cb_lru_entry *entry);
+
+static struct cb_lru_entry *
+find_entry(struct cb_lru *lru, int32_t id);
+
+static void
+evict_entry(struct cb_lru *lru);
+
+/*Creates an empty list that holds entries of a total size of at most
+  "capacity".*/
+struct cb_lru *
+cb_lru_init(int64_t capacity, void (*free_entry)(struct cb_lru_entry *entry))
+{
+    struct cb_lru *lru;
+    int32_t i;
+
+    lru = malloc(sizeof(*lru));
+    assert(lru);
+
+    lru->buckets = malloc(CABLAST_LRU_BUCKETS * sizeof(*lru->buckets));
+    assert(lru->buckets);
+    for (i = 0; i < CABLAST_LRU_BUCKETS; i++)
+        lru->buckets[i] = NULL;
+
+    lru->first = NULL;
+    lru->last = NULL;
+    lru->size = 0;
+    lru->capacity = capacity;
+    lru->free_entry = free_entry;
+
+    return lru;
+}
+
+void
+cb_lru_free(struct cb_lru *lru)
+{
+    if (lru == NULL)
+        return;
+
+    while (lru->last != NULL)
+        evict_entry(lru);
+    free(lru->buckets);
+    free(lru);
+}
+
+/*Returns the entry with the ID passed into id and marks it as the most
+  recently used, or returns NULL if there is no such entry.*/
+struct cb_lru_entry *
+cb_lru_get(struct cb_lru *lru, int32_t id)
+{
+    struct cb_lru_entry *entry;
+
+    if (NULL != (entry = find_entry(lru, id))) {
+        unlink_entry(lru, entry);
+        push_entry(lru, entry);
+    }
+    return entry;
+}
+
+/*Adds an entry as the most recently used one and evicts the least recently
+ *used entries until the total size is back under the capacity.  Returns
+ *false without adding the entry if it is bigger than the capacity or if there
+ *already is an entry with its ID; the caller still owns the entry then.
+ */
+bool
+cb_lru_add(struct cb_lru *lru, struct cb_lru_entry *entry)
+{
+    int32_t bucket = entry->id & (CABLAST_LRU_BUCKETS - 1);
+
+    if (entry->size > lru->capacity || find_entry(lru, entry->id) != NULL)
+        return false;
+
+    entry->next_in_bucket = lru->buckets[bucket];
+    lru->buckets[bucket] = entry;
+    push_entry(lru, entry);
+    lru->size += entry->size;
+
+    while (lru->size > lru->capacity)
+        evict_entry(lru);
+    return true;
+}
+
+/*Removes an entry from the list of entries in order of use.*/
+static void
+unlink_entry(struct cb_lru *lru, struct cb_lru_entry *entry)
+{
+    if (entry->prev != NULL)
+        entry->prev->next = entry->next;
+    else
+        lru->first = entry->next;
+    if (entry->next != NULL)
+        entry->next->prev = entry->prev;
+    else
+        lru->last = entry->prev;
+}
+
+/*Puts an entry at the front of the list of entries in order of use.*/
+static void
+push_entry(struct cb_lru *lru, struct cb_lru_entry *entry)
+{
+    entry->prev = NULL;
+    entry->next = lru->first;
+    if (lru->first != NULL)
+        lru->first->prev = entry;
+    else
+        lru->last = entry;
+    lru->first = entry;
+}
+
+static struct cb_lru_entry *
+find_entry(struct cb_lru *lru, int32_t id)
+{
+    struct cb_lru_entry *entry;
+
+    entry = lru->buckets[id & (CABLAST_LRU_BUCKETS - 1)];
+    for (; entry != NULL; entry = entry->next_in_bucket)
+        if (entry->id == id)
+            return entry;
+    return NULL;
+}
+
+/*Removes the least recently used entry and frees it.*/
+static void
+evict_entry(struct cb_lru *lru)
+{
+    struct cb_lru_entry *entry = lru->last, **p;
+
+    unlink_entry(lru, entry);
+    p = &lru->buckets[entry->id & (CABLAST_LRU_BUCKETS - 1)];
+    while (*p != entry)
+        p = &(*p)->next_in_bucket;
+    *p = entry->next_in_bucket;
+
+    lru->size -= entry->size;
+    lru->free_entry(entry);
+}
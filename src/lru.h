@@ -0,0 +1,48 @@
+#ifndef __CABLAST_LRU_H__
+#define __CABLAST_LRU_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CABLAST_LRU_BUCKETS (1 << 12)
+
+/*The part of an entry that the list of entries in order of use and the hash
+ *table keyed by ID work with.  Caches put it as the first member of their own
+ *entries, so a pointer to one is a pointer to the other, and set "size" to
+ *what the entry counts towards the capacity.
+ */
+struct cb_lru_entry {
+    int32_t id;
+    int64_t size;
+    struct cb_lru_entry *prev;
+    struct cb_lru_entry *next;
+    struct cb_lru_entry *next_in_bucket;
+};
+
+/*Entries from the most to the least recently used, whose total size never
+ *goes over "capacity".  Evicted entries are freed with free_entry.  Nothing
+ *here is locked; a cache shared by threads must hold its own lock around
+ *every call.
+ */
+struct cb_lru {
+    struct cb_lru_entry **buckets;
+    struct cb_lru_entry *first;
+    struct cb_lru_entry *last;
+    int64_t size;
+    int64_t capacity;
+    void (*free_entry)(struct cb_lru_entry *entry);
+};
+
+struct cb_lru *
+cb_lru_init(int64_t capacity, void (*free_entry)(struct cb_lru_entry *entry));
+
+void
+cb_lru_free(struct cb_lru *lru);
+
+struct cb_lru_entry *
+cb_lru_get(struct cb_lru *lru, int32_t id);
+
+bool
+cb_lru_add(struct cb_lru *lru, struct cb_lru_entry *entry);
+
+#endif
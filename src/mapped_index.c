@@ -0,0 +1,59 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bitpack.h"
+#include "mapped_index.h"
+
+/*Maps the whole of an open index file into memory.  Returns NULL if the file
+ *is NULL, empty or cannot be mapped, in which case the caller should keep
+ *reading the index through the FILE pointer.  The file must not be written to
+ *while it is mapped.
+ */
+struct cb_mapped_index *
+cb_mapped_index_init(FILE *f)
+{
+    struct cb_mapped_index *index;
+    struct stat buf;
+    void *bytes;
+
+    if (f == NULL || 0 != fstat(fileno(f), &buf) || buf.st_size < 8)
+        return NULL;
+
+    bytes = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if (bytes == MAP_FAILED)
+        return NULL;
+
+    index = malloc(sizeof(*index));
+    assert(index);
+
+    index->bytes = (unsigned char *)bytes;
+    index->length = buf.st_size;
+    index->size = buf.st_size / 8;
+
+    return index;
+}
+
+void
+cb_mapped_index_free(struct cb_mapped_index *index)
+{
+    if (index == NULL)
+        return;
+    munmap(index->bytes, index->length);
+    free(index);
+}
+
+/*Returns the i-th integer in a mapped index, or -1 if the index does not have
+  that many entries.*/
+int64_t
+cb_mapped_index_get(struct cb_mapped_index *index, int32_t i)
+{
+    if (i < 0 || i >= index->size)
+        return (int64_t)(-1);
+
+    return (int64_t)read_int_from_bytes(index->bytes + (int64_t)i * 8, 8);
+}
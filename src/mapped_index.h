@@ -0,0 +1,24 @@
+#ifndef __CABLAST_MAPPED_INDEX_H__
+#define __CABLAST_MAPPED_INDEX_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*A read-only memory map of an index file in a CaBLAST database, which is a
+  list of 8-byte big-endian integers (byte offsets or sequence lengths).*/
+struct cb_mapped_index {
+    unsigned char *bytes;
+    int64_t length; /*in bytes*/
+    int64_t size; /*in entries*/
+};
+
+struct cb_mapped_index *
+cb_mapped_index_init(FILE *f);
+
+void
+cb_mapped_index_free(struct cb_mapped_index *index);
+
+int64_t
+cb_mapped_index_get(struct cb_mapped_index *index, int32_t i);
+
+#endif
@@ -0,0 +1,180 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bitpack.h"
+#include "names_file.h"
+#include "writer.h"
+
+/*A name being written, which is the first length characters of a header.*/
+struct names_entry {
+    const char *name;
+    int32_t length;
+    int32_t id;
+};
+
+static int
+compare_entries(const void *a, const void *b);
+
+static const char *
+entry_name(struct cb_names_file *names_file, int32_t i);
+
+/*Writes a name index for the sequences whose FASTA headers are in headers,
+  where headers[i] is the header of the sequence with ID i.*/
+void
+cb_names_file_write(char **headers, int32_t count, FILE *f)
+{
+    struct names_entry *entries;
+    struct cb_writer *w;
+    int64_t offset;
+    int32_t i;
+
+    entries = malloc(count * sizeof(*entries));
+    assert(entries);
+    for (i = 0; i < count; i++) {
+        entries[i].name = headers[i];
+        entries[i].length = strcspn(headers[i], " \t");
+        entries[i].id = i;
+    }
+    qsort(entries, count, sizeof(*entries), compare_entries);
+
+    output_format_header(CABLAST_NAMES_MAGIC, CABLAST_NAMES_VERSION, f);
+    output_int_to_file(count, 4, f);
+
+    w = cb_writer_init(f);
+    offset = CABLAST_NAMES_HEADER_SIZE + 12 * (int64_t)count;
+    for (i = 0; i < count; i++) {
+        cb_writer_int(w, offset, 8);
+        cb_writer_int(w, entries[i].id, 4);
+        offset += entries[i].length + 1;
+    }
+    for (i = 0; i < count; i++) {
+        cb_writer_bytes(w, entries[i].name, entries[i].length);
+        cb_writer_char(w, '\0');
+    }
+    cb_writer_free(w);
+
+    free(entries);
+}
+
+/*Maps a names file for reading, or returns NULL if f is NULL or is not a
+ *complete names file in the current format.  Names are written in the order
+ *of their offsets and the file ends with a '\0', so every name is inside of
+ *the file if the last one starts inside of it.
+ */
+struct cb_names_file *
+cb_names_file_init(FILE *f)
+{
+    struct cb_names_file *names_file;
+    struct stat buf;
+    unsigned char *bytes;
+    int64_t count, last = 0;
+    int32_t i;
+    void *map;
+
+    if (f == NULL || 0 != fstat(fileno(f), &buf) ||
+          buf.st_size < CABLAST_NAMES_HEADER_SIZE)
+        return NULL;
+
+    map = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    bytes = (unsigned char *)map;
+
+    for (i = 0; CABLAST_NAMES_MAGIC[i] != '\0'; i++)
+        if (bytes[i] != (unsigned char)CABLAST_NAMES_MAGIC[i])
+            break;
+    count = (int64_t)read_int_from_bytes(bytes + 8, 4);
+    if (buf.st_size >= CABLAST_NAMES_HEADER_SIZE + 12 * count && count > 0)
+        last = (int64_t)read_int_from_bytes(bytes + CABLAST_NAMES_HEADER_SIZE +
+                                            12 * (count - 1), 8);
+    if (CABLAST_NAMES_MAGIC[i] != '\0' || bytes[i] != CABLAST_NAMES_VERSION ||
+          buf.st_size < CABLAST_NAMES_HEADER_SIZE + 12 * count ||
+          (count > 0 && (bytes[buf.st_size-1] != '\0' ||
+                         last < CABLAST_NAMES_HEADER_SIZE + 12 * count ||
+                         last >= buf.st_size))) {
+        munmap(map, buf.st_size);
+        return NULL;
+    }
+
+    names_file = malloc(sizeof(*names_file));
+    assert(names_file);
+
+    names_file->bytes = bytes;
+    names_file->length = buf.st_size;
+    names_file->count = (int32_t)count;
+
+    return names_file;
+}
+
+void
+cb_names_file_free(struct cb_names_file *names_file)
+{
+    if (names_file == NULL)
+        return;
+    munmap(names_file->bytes, names_file->length);
+    free(names_file);
+}
+
+/*Returns the number of sequences called name and sets *first to the position
+  of the first of them in the names file, so that their IDs can be read with
+  cb_names_file_id.*/
+int32_t
+cb_names_file_find(struct cb_names_file *names_file, const char *name,
+                   int32_t *first)
+{
+    int32_t lo = 0, hi = names_file->count, mid, end;
+
+    /*Find the first entry that is not less than name.*/
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (strcmp(entry_name(names_file, mid), name) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *first = lo;
+    for (end = lo; end < names_file->count; end++)
+        if (strcmp(entry_name(names_file, end), name) != 0)
+            break;
+    return end - lo;
+}
+
+/*Returns the ID of the sequence at position i in a names file.*/
+int32_t
+cb_names_file_id(struct cb_names_file *names_file, int32_t i)
+{
+    return (int32_t)read_int_from_bytes(names_file->bytes +
+                                        CABLAST_NAMES_HEADER_SIZE +
+                                        12 * (int64_t)i + 8, 4);
+}
+
+/*Orders names like strcmp, and sequences with the same name by ID.*/
+static int
+compare_entries(const void *a, const void *b)
+{
+    const struct names_entry *x = (const struct names_entry *)a;
+    const struct names_entry *y = (const struct names_entry *)b;
+    int cmp;
+
+    cmp = memcmp(x->name, y->name,
+                 x->length < y->length ? x->length : y->length);
+    if (cmp == 0)
+        cmp = x->length - y->length;
+    if (cmp == 0)
+        cmp = x->id - y->id;
+    return cmp;
+}
+
+static const char *
+entry_name(struct cb_names_file *names_file, int32_t i)
+{
+    return (const char *)names_file->bytes +
+           read_int_from_bytes(names_file->bytes + CABLAST_NAMES_HEADER_SIZE +
+                               12 * (int64_t)i, 8);
+}
@@ -0,0 +1,43 @@
+#ifndef __CABLAST_NAMES_FILE_H__
+#define __CABLAST_NAMES_FILE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*compressed.cb.names maps the names of the original sequences to their IDs.
+ *It starts with this magic string followed by a byte with the version of the
+ *file's format and the number of names as a 4-byte integer.  Then comes one
+ *12-byte entry per name, sorted by name and then by ID: the 8-byte offset in
+ *the file of the name and the 4-byte ID of its sequence.  The names follow,
+ *each ending with a NUL byte.  A sequence's name is its FASTA header up to the
+ *first space.  All integers are big-endian, so the file can be mapped and
+ *binary searched without being parsed.
+ */
+#define CABLAST_NAMES_MAGIC "CBLASTN"
+#define CABLAST_NAMES_VERSION 1
+#define CABLAST_NAMES_HEADER_SIZE 12
+
+/*A read-only memory map of a compressed.cb.names file.*/
+struct cb_names_file {
+    unsigned char *bytes;
+    int64_t length;
+    int32_t count;
+};
+
+void
+cb_names_file_write(char **headers, int32_t count, FILE *f);
+
+struct cb_names_file *
+cb_names_file_init(FILE *f);
+
+void
+cb_names_file_free(struct cb_names_file *names_file);
+
+int32_t
+cb_names_file_find(struct cb_names_file *names_file, const char *name,
+                   int32_t *first);
+
+int32_t
+cb_names_file_id(struct cb_names_file *names_file, int32_t i);
+
+#endif
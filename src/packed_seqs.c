@@ -0,0 +1,200 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bitpack.h"
+#include "packed_seqs.h"
+
+#define EXCEPTION_SIZE 9
+
+static int
+residue_code(char c);
+
+static unsigned char *
+find_seq(struct cb_packed_seqs *packed, int32_t id);
+
+/*Appends a sequence to a packed sequence file, and its offset in the file to
+  the file's index.*/
+void
+cb_packed_seqs_write(struct cb_writer *f, struct cb_writer *index,
+                     const char *residues, int32_t length)
+{
+    int32_t i, run, num_exceptions = 0;
+    int byte = 0;
+
+    cb_writer_int(index, (uint64_t)cb_writer_tell(f), 8);
+
+    for (i = 0; i < length; i++)
+        if (residue_code(residues[i]) < 0 &&
+              (i == 0 || residues[i-1] != residues[i]))
+            num_exceptions++;
+
+    cb_writer_int(f, (uint64_t)length, 4);
+    cb_writer_int(f, (uint64_t)num_exceptions, 4);
+
+    /*Output each run of identical residues that cannot be packed.*/
+    for (i = 0; i < length; i += run) {
+        run = 1;
+        if (residue_code(residues[i]) >= 0)
+            continue;
+        while (i + run < length && residues[i+run] == residues[i])
+            run++;
+        cb_writer_int(f, (uint64_t)i, 4);
+        cb_writer_int(f, (uint64_t)run, 4);
+        cb_writer_char(f, residues[i]);
+    }
+
+    /*Exceptions are packed as A so that every residue takes two bits.*/
+    for (i = 0; i < length; i++) {
+        byte = (byte << 2) | (residue_code(residues[i]) < 0 ?
+                              0 : residue_code(residues[i]));
+        if (i % 4 == 3) {
+            cb_writer_char(f, (char)byte);
+            byte = 0;
+        }
+    }
+    if (length % 4 != 0)
+        cb_writer_char(f, (char)(byte << (2 * (4 - length % 4))));
+}
+
+/*Maps a packed sequence file and its index into memory.  Returns NULL if
+  either file is missing, empty or cannot be mapped.*/
+struct cb_packed_seqs *
+cb_packed_seqs_init(FILE *f, FILE *index)
+{
+    struct cb_packed_seqs *packed;
+    struct cb_mapped_index *map_index;
+    struct stat buf;
+    void *bytes;
+
+    if (f == NULL || 0 != fstat(fileno(f), &buf) || buf.st_size == 0)
+        return NULL;
+    if (NULL == (map_index = cb_mapped_index_init(index)))
+        return NULL;
+
+    bytes = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if (bytes == MAP_FAILED) {
+        cb_mapped_index_free(map_index);
+        return NULL;
+    }
+
+    packed = malloc(sizeof(*packed));
+    assert(packed);
+
+    packed->bytes = (unsigned char *)bytes;
+    packed->length = buf.st_size;
+    packed->index = map_index;
+
+    return packed;
+}
+
+void
+cb_packed_seqs_free(struct cb_packed_seqs *packed)
+{
+    if (packed == NULL)
+        return;
+    munmap(packed->bytes, packed->length);
+    cb_mapped_index_free(packed->index);
+    free(packed);
+}
+
+/*Returns the number of residues in the sequence with the ID passed into id,
+  or -1 if there is no such sequence.*/
+int32_t
+cb_packed_seqs_length(struct cb_packed_seqs *packed, int32_t id)
+{
+    unsigned char *seq = find_seq(packed, id);
+
+    return seq == NULL ? -1 : (int32_t)read_int_from_bytes(seq, 4);
+}
+
+/*Returns a new string with the residues from start up to but not including
+ *end of the sequence with the ID passed into id, or NULL if there is no such
+ *sequence.  Only the bytes holding those residues and the exceptions inside of
+ *the range are read, so the cost does not depend on the length of the
+ *sequence.  The range is clipped to the end of the sequence.
+ */
+char *
+cb_packed_seqs_get(struct cb_packed_seqs *packed, int32_t id,
+                   int32_t start, int32_t end)
+{
+    static const char bases[] = "ACGT";
+    unsigned char *seq, *exceptions, *residues, *e;
+    int32_t length, num_exceptions, lo, hi, mid, i, j, from, to;
+    char *s;
+
+    if (NULL == (seq = find_seq(packed, id)))
+        return NULL;
+
+    length = (int32_t)read_int_from_bytes(seq, 4);
+    num_exceptions = (int32_t)read_int_from_bytes(seq + 4, 4);
+    exceptions = seq + 8;
+    residues = exceptions + (int64_t)num_exceptions * EXCEPTION_SIZE;
+
+    if (start < 0)
+        start = 0;
+    if (end > length)
+        end = length;
+    if (end < start)
+        end = start;
+
+    s = malloc((end - start + 1)*sizeof(*s));
+    assert(s);
+
+    for (i = start; i < end; i++)
+        s[i-start] = bases[(residues[i/4] >> (2 * (3 - i % 4))) & 3];
+    s[end-start] = '\0';
+
+    /*Find the first exception that ends after start.*/
+    lo = 0;
+    hi = num_exceptions;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        e = exceptions + mid*EXCEPTION_SIZE;
+        if (read_int_from_bytes(e, 4) + read_int_from_bytes(e + 4, 4) <=
+              (uint64_t)start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (i = lo; i < num_exceptions; i++) {
+        e = exceptions + i*EXCEPTION_SIZE;
+        from = (int32_t)read_int_from_bytes(e, 4);
+        if (from >= end)
+            break;
+        to = from + (int32_t)read_int_from_bytes(e + 4, 4);
+        for (j = from < start ? start : from; j < to && j < end; j++)
+            s[j-start] = (char)e[8];
+    }
+    return s;
+}
+
+/*Returns the 2-bit code of a residue that can be packed, or -1 if the residue
+  has to be stored as an exception.*/
+static int
+residue_code(char c)
+{
+    switch (c) {
+    case 'A': return 0;
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'T': return 3;
+    }
+    return -1;
+}
+
+/*Returns a pointer to the start of a sequence in the mapped file, or NULL if
+  the index has no sequence with the ID passed into id.*/
+static unsigned char *
+find_seq(struct cb_packed_seqs *packed, int32_t id)
+{
+    int64_t offset = cb_mapped_index_get(packed->index, id);
+
+    if (offset < 0 || offset + 8 > packed->length)
+        return NULL;
+    return packed->bytes + offset;
+}
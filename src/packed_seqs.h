@@ -0,0 +1,42 @@
+#ifndef __CABLAST_PACKED_SEQS_H__
+#define __CABLAST_PACKED_SEQS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mapped_index.h"
+#include "writer.h"
+
+/*A read-only memory map of a file of sequences packed two bits per residue,
+ *along with the index of the byte offset of each sequence in the file.
+ *
+ *Each sequence is stored as a 4-byte length, a 4-byte count of exceptions, the
+ *exceptions and then the packed residues, high bits first.  An exception is a
+ *run of residues other than A, C, G and T (usually N), stored as a 4-byte
+ *start, a 4-byte length and the residue itself, in order of start.  All
+ *integers are big-endian.
+ */
+struct cb_packed_seqs {
+    unsigned char *bytes;
+    int64_t length;
+    struct cb_mapped_index *index;
+};
+
+void
+cb_packed_seqs_write(struct cb_writer *f, struct cb_writer *index,
+                     const char *residues, int32_t length);
+
+struct cb_packed_seqs *
+cb_packed_seqs_init(FILE *f, FILE *index);
+
+void
+cb_packed_seqs_free(struct cb_packed_seqs *packed);
+
+int32_t
+cb_packed_seqs_length(struct cb_packed_seqs *packed, int32_t id);
+
+char *
+cb_packed_seqs_get(struct cb_packed_seqs *packed, int32_t id,
+                   int32_t start, int32_t end);
+
+#endif
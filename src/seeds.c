@@ -2,6 +2,7 @@
 #include <stdlib.h>
 
 #include "coarse.h"
+#include "dust.h"
 #include "seeds.h"
 
 const int8_t cb_seeds_alpha_size[] = {
@@ -90,15 +91,23 @@ cb_seeds_free(struct cb_seeds *seeds) {
 }
 
 void
-cb_seeds_add(struct cb_seeds *seeds, struct cb_coarse_seq *seq)
+cb_seeds_add(struct cb_seeds *seeds, struct cb_coarse_seq *seq,
+             int32_t dust_window, int32_t dust_level)
 {
     char *kmer;
     int32_t hash, i;
     struct cb_seed_loc *sl1, *sl2;
+    bool *dust;
+
+    /*Seeds in low-complexity regions are left out of the table.*/
+    dust = cb_dust_mask(seq->seq->residues, seq->seq->length, seeds->seed_size,
+                        dust_window, dust_level);
 
     pthread_rwlock_wrlock(&seeds->lock);
 
     for (i = 0; i < seq->seq->length - seeds->seed_size+1; i++) {
+        if (dust != NULL && dust[i])
+            continue;
         kmer = seq->seq->residues + i;
         sl1 = cb_seed_loc_init(seq->id, i);
         hash = hash_kmer(seeds, kmer);
@@ -110,6 +119,8 @@ cb_seeds_add(struct cb_seeds *seeds, struct cb_coarse_seq *seq)
         }
     }
     pthread_rwlock_unlock(&seeds->lock);
+
+    free(dust);
 }
 
 struct cb_seed_loc *
@@ -138,7 +149,7 @@ cb_seeds_lookup(struct cb_seeds *seeds, char *kmer)
 }
 
 struct cb_seed_loc *
-cb_seed_loc_init(uint32_t coarse_seq_id, uint16_t residue_index)
+cb_seed_loc_init(uint32_t coarse_seq_id, uint32_t residue_index)
 {
     struct cb_seed_loc *seedLoc;
 
@@ -13,12 +13,12 @@ const int8_t cb_seeds_alpha_size[26];
 
 struct cb_seed_loc {
     uint32_t coarse_seq_id;
-    uint16_t residue_index;
+    uint32_t residue_index;
     struct cb_seed_loc *next;
 };
 
 struct cb_seed_loc *
-cb_seed_loc_init(uint32_t coarse_seq_id, uint16_t residue_index);
+cb_seed_loc_init(uint32_t coarse_seq_id, uint32_t residue_index);
 
 void
 cb_seed_loc_free(struct cb_seed_loc *seedLoc);
@@ -41,7 +41,8 @@ cb_seeds_free(struct cb_seeds *seeds);
 struct cb_coarse_seq;
 
 void
-cb_seeds_add(struct cb_seeds *seeds, struct cb_coarse_seq *seq);
+cb_seeds_add(struct cb_seeds *seeds, struct cb_coarse_seq *seq,
+             int32_t dust_window, int32_t dust_level);
 
 /* Produces a copy of the list of seeds for 'kmer', and therefore the
  * result needs to be freed with `cb_seed_loc_free` when finished. */
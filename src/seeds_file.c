@@ -0,0 +1,409 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bitpack.h"
+#include "seeds_file.h"
+
+#define SEEDS_FILE_BUFFER_SIZE (1 << 20)
+
+/*The range of k-mer hashes a thread writes, from "from" up to but not
+  including "to", and where its offsets and locations go in the file.*/
+struct seeds_file_part {
+    struct cb_seeds *seeds;
+    int fd;
+    int32_t from;
+    int32_t to;
+    int64_t offsets_pos;
+    int64_t locs_pos;
+    int64_t first_loc;
+    int64_t num_locs;
+};
+
+/*A block of bytes written to the file with pwrite when it fills up.*/
+struct seeds_file_buffer {
+    int fd;
+    int64_t pos;
+    int32_t used;
+    char bytes[SEEDS_FILE_BUFFER_SIZE];
+};
+
+static void *
+count_part(void *data);
+
+static void *
+write_part(void *data);
+
+static void
+run_parts(struct seeds_file_part *parts, int32_t threads,
+          void *(*f)(void *));
+
+static void
+buffer_int(struct seeds_file_buffer *buf, uint64_t n, int bytes);
+
+static void
+buffer_flush(struct seeds_file_buffer *buf);
+
+static int32_t
+read_v1_seeds(FILE *f, struct cb_seeds *seeds);
+
+static int32_t
+find_locs(struct cb_seeds_file *seeds_file, char *kmer, int64_t *first);
+
+/*Writes a seeds table to f straight from its buckets.  The hashes are split
+ *into one range per thread; the threads first count the locations in their
+ *ranges so that every range knows where its part of the offset table and
+ *location array starts, and then write both parts at those positions with
+ *pwrite.  When this returns f is positioned at the end of the file.
+ */
+void
+cb_seeds_file_write(struct cb_seeds *seeds, FILE *f, int32_t threads)
+{
+    struct seeds_file_part *parts;
+    int64_t base, num_locs = 0;
+    int32_t i;
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > seeds->locs_length)
+        threads = seeds->locs_length;
+
+    output_format_header(CABLAST_SEEDS_MAGIC, CABLAST_SEEDS_VERSION, f);
+    output_int_to_file(seeds->seed_size, 4, f);
+    fflush(f);
+    base = ftell(f);
+
+    parts = malloc(threads*sizeof(*parts));
+    assert(parts);
+    for (i = 0; i < threads; i++) {
+        parts[i].seeds = seeds;
+        parts[i].fd = fileno(f);
+        parts[i].from = (int32_t)((int64_t)seeds->locs_length * i / threads);
+        parts[i].to = (int32_t)((int64_t)seeds->locs_length * (i+1) / threads);
+    }
+
+    pthread_rwlock_rdlock(&seeds->lock);
+    run_parts(parts, threads, count_part);
+    for (i = 0; i < threads; i++) {
+        parts[i].first_loc = num_locs;
+        parts[i].offsets_pos = base + 8 * (int64_t)parts[i].from;
+        parts[i].locs_pos = base + 8 * ((int64_t)seeds->locs_length + 1) +
+                            8 * num_locs;
+        num_locs += parts[i].num_locs;
+    }
+    run_parts(parts, threads, write_part);
+    pthread_rwlock_unlock(&seeds->lock);
+
+    /*The offset past the end of the last k-mer's locations.*/
+    fseek(f, base + 8 * (int64_t)seeds->locs_length, SEEK_SET);
+    output_int_to_file(num_locs, 8, f);
+    fseek(f, 0, SEEK_END);
+
+    free(parts);
+}
+
+/*Copies a coarse.seeds file from "in" to "out" in the current version of the
+ *format.  Files in version 1 do not record their seed size, so it is passed
+ *into seed_size; files already in the current format are copied as they are.
+ *Returns the number of k-mers with at least one location, or -1 for a file
+ *that was already current.
+ */
+int32_t
+cb_seeds_file_convert(FILE *in, FILE *out, int32_t seed_size,
+                      int32_t threads)
+{
+    struct cb_seeds *seeds;
+    char buf[4096];
+    size_t n;
+    int32_t num_kmers;
+
+    if (read_format_header(CABLAST_SEEDS_MAGIC, in) == CABLAST_SEEDS_VERSION) {
+        fseek(in, 0, SEEK_SET);
+        while (0 < (n = fread(buf, sizeof(*buf), sizeof(buf), in)))
+            fwrite(buf, sizeof(*buf), n, out);
+        return -1;
+    }
+
+    seeds = cb_seeds_init(seed_size);
+    num_kmers = read_v1_seeds(in, seeds);
+    cb_seeds_file_write(seeds, out, threads);
+    cb_seeds_free(seeds);
+
+    return num_kmers;
+}
+
+/*Maps a coarse.seeds file into memory.  Returns NULL if the file is missing,
+ *was written in an older format, is truncated or cannot be mapped.  Opening
+ *the file takes the same time no matter how large it is; pages of the offset
+ *table and location array are only read when a lookup touches them.
+ */
+struct cb_seeds_file *
+cb_seeds_file_init(FILE *f)
+{
+    struct cb_seeds_file *seeds_file;
+    struct stat buf;
+    unsigned char *bytes;
+    int64_t num_hashes, num_locs;
+    int32_t seed_size, i;
+    void *map;
+
+    if (f == NULL || 0 != fstat(fileno(f), &buf) ||
+          buf.st_size < CABLAST_SEEDS_HEADER_SIZE)
+        return NULL;
+
+    map = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fileno(f), 0);
+    if (map == MAP_FAILED)
+        return NULL;
+    bytes = (unsigned char *)map;
+
+    for (i = 0; CABLAST_SEEDS_MAGIC[i] != '\0'; i++)
+        if (bytes[i] != (unsigned char)CABLAST_SEEDS_MAGIC[i])
+            break;
+    seed_size = (int32_t)read_int_from_bytes(bytes + 8, 4);
+    num_hashes = (int64_t)1 << (2 * seed_size);
+    if (CABLAST_SEEDS_MAGIC[i] != '\0' || bytes[i] != CABLAST_SEEDS_VERSION ||
+          seed_size < 1 || seed_size > 15 ||
+          buf.st_size < CABLAST_SEEDS_HEADER_SIZE + 8 * (num_hashes + 1)) {
+        munmap(map, buf.st_size);
+        return NULL;
+    }
+    num_locs = (int64_t)read_int_from_bytes(bytes + CABLAST_SEEDS_HEADER_SIZE +
+                                            8 * num_hashes, 8);
+    if (buf.st_size != CABLAST_SEEDS_HEADER_SIZE + 8 * (num_hashes + 1) +
+                       8 * num_locs) {
+        munmap(map, buf.st_size);
+        return NULL;
+    }
+
+    seeds_file = malloc(sizeof(*seeds_file));
+    assert(seeds_file);
+
+    seeds_file->bytes = bytes;
+    seeds_file->length = buf.st_size;
+    seeds_file->seed_size = seed_size;
+    seeds_file->num_hashes = (int32_t)num_hashes;
+    seeds_file->offsets = bytes + CABLAST_SEEDS_HEADER_SIZE;
+    seeds_file->locs = seeds_file->offsets + 8 * (num_hashes + 1);
+
+    return seeds_file;
+}
+
+void
+cb_seeds_file_free(struct cb_seeds_file *seeds_file)
+{
+    if (seeds_file == NULL)
+        return;
+    munmap(seeds_file->bytes, seeds_file->length);
+    free(seeds_file);
+}
+
+/*Returns the number of locations of a k-mer in a mapped seeds file.*/
+int64_t
+cb_seeds_file_count(struct cb_seeds_file *seeds_file, char *kmer)
+{
+    int64_t first;
+
+    return find_locs(seeds_file, kmer, &first);
+}
+
+/*Returns a new list of the locations of a k-mer in a mapped seeds file in the
+ *order they were added to the seeds table, or NULL if the k-mer has none or
+ *has a residue other than A, C, G or T.  Like the list returned by
+ *cb_seeds_lookup, it needs to be freed with cb_seed_loc_free.
+ */
+struct cb_seed_loc *
+cb_seeds_file_lookup(struct cb_seeds_file *seeds_file, char *kmer)
+{
+    struct cb_seed_loc *first = NULL, *last = NULL, *loc;
+    unsigned char *p;
+    int64_t start, count, i;
+
+    count = find_locs(seeds_file, kmer, &start);
+    for (i = 0; i < count; i++) {
+        p = seeds_file->locs + 8 * (start + i);
+        loc = cb_seed_loc_init((uint32_t)read_int_from_bytes(p, 4),
+                               (uint32_t)read_int_from_bytes(p + 4, 4));
+        if (last == NULL)
+            first = loc;
+        else
+            last->next = loc;
+        last = loc;
+    }
+    return first;
+}
+
+/*Counts the seed locations in a part of the seeds table.*/
+static void *
+count_part(void *data)
+{
+    struct seeds_file_part *part = (struct seeds_file_part *)data;
+    struct cb_seed_loc *loc;
+    int32_t i;
+
+    part->num_locs = 0;
+    for (i = part->from; i < part->to; i++)
+        for (loc = part->seeds->locs[i]; loc != NULL; loc = loc->next)
+            part->num_locs++;
+    return NULL;
+}
+
+/*Writes the offsets and locations of a part of the seeds table.*/
+static void *
+write_part(void *data)
+{
+    struct seeds_file_part *part = (struct seeds_file_part *)data;
+    struct seeds_file_buffer *offsets, *locs;
+    struct cb_seed_loc *loc;
+    int64_t n = part->first_loc;
+    int32_t i;
+
+    offsets = malloc(sizeof(*offsets));
+    assert(offsets);
+    locs = malloc(sizeof(*locs));
+    assert(locs);
+
+    offsets->fd = locs->fd = part->fd;
+    offsets->pos = part->offsets_pos;
+    locs->pos = part->locs_pos;
+    offsets->used = locs->used = 0;
+
+    for (i = part->from; i < part->to; i++) {
+        buffer_int(offsets, n, 8);
+        for (loc = part->seeds->locs[i]; loc != NULL; loc = loc->next) {
+            buffer_int(locs, loc->coarse_seq_id, 4);
+            buffer_int(locs, loc->residue_index, 4);
+            n++;
+        }
+    }
+    buffer_flush(offsets);
+    buffer_flush(locs);
+
+    free(offsets);
+    free(locs);
+    return NULL;
+}
+
+/*Runs f on every part, one thread per part, and waits for all of them.*/
+static void
+run_parts(struct seeds_file_part *parts, int32_t threads,
+          void *(*f)(void *))
+{
+    pthread_t *ids;
+    int32_t i, errno;
+
+    ids = malloc(threads*sizeof(*ids));
+    assert(ids);
+
+    for (i = 0; i < threads; i++)
+        if (0 != (errno = pthread_create(&ids[i], NULL, f, &parts[i]))) {
+            fprintf(stderr,
+                "cb_seeds_file_write: Could not start thread. Errno: %d\n",
+                errno);
+            exit(1);
+        }
+    for (i = 0; i < threads; i++)
+        if (0 != (errno = pthread_join(ids[i], NULL))) {
+            fprintf(stderr,
+                "cb_seeds_file_write: Could not join thread. Errno: %d\n",
+                errno);
+            exit(1);
+        }
+
+    free(ids);
+}
+
+static void
+buffer_int(struct seeds_file_buffer *buf, uint64_t n, int bytes)
+{
+    int i;
+
+    if (buf->used + bytes > SEEDS_FILE_BUFFER_SIZE)
+        buffer_flush(buf);
+    for (i = bytes - 1; i >= 0; i--, n >>= 8)
+        buf->bytes[buf->used + i] = (char)(n & 0xff);
+    buf->used += bytes;
+}
+
+static void
+buffer_flush(struct seeds_file_buffer *buf)
+{
+    if (buf->used > 0 && (ssize_t)buf->used !=
+                           pwrite(buf->fd, buf->bytes, buf->used, buf->pos)) {
+        fprintf(stderr, "Could not write the seeds file.\n");
+        exit(1);
+    }
+    buf->pos += buf->used;
+    buf->used = 0;
+}
+
+/*Reads the seeds in a coarse.seeds file in version 1 of the format into an
+ *empty seeds table and returns the number of k-mers read.  Each k-mer with
+ *locations is a 4-byte hash followed by its locations, each a 4-byte coarse
+ *sequence ID and a 2-byte residue index, with a 0 byte between locations and a
+ *1 byte after the last one.  The file ends with a newline.
+ */
+static int32_t
+read_v1_seeds(FILE *f, struct cb_seeds *seeds)
+{
+    struct cb_seed_loc *loc, *last;
+    int32_t hash, num_kmers = 0;
+    uint32_t coarse_seq_id;
+    int c;
+
+    while (true) {
+        hash = (int32_t)read_int_from_file(4, f);
+        if (feof(f))
+            break;
+        if (hash < 0 || hash >= seeds->locs_length) {
+            fprintf(stderr, "coarse.seeds was not made with a seed size of "
+                            "%d.\n", seeds->seed_size);
+            exit(1);
+        }
+
+        last = NULL;
+        do {
+            coarse_seq_id = (uint32_t)read_int_from_file(4, f);
+            loc = cb_seed_loc_init(coarse_seq_id,
+                                   (uint32_t)read_int_from_file(2, f));
+            if (last == NULL)
+                seeds->locs[hash] = loc;
+            else
+                last->next = loc;
+            last = loc;
+        } while (0 == (c = getc(f)));
+
+        num_kmers++;
+        if (c == EOF)
+            break;
+    }
+    return num_kmers;
+}
+
+/*Finds the locations of a k-mer, hashed the same way as in the seeds table.
+  Sets *first to the index of the first one in the location array and returns
+  how many there are.*/
+static int32_t
+find_locs(struct cb_seeds_file *seeds_file, char *kmer, int64_t *first)
+{
+    int32_t hash = 0, i, c;
+    int64_t end;
+    unsigned char *p;
+
+    for (i = seeds_file->seed_size - 1; i >= 0; i--) {
+        c = kmer[i] - 'A';
+        if (c < 0 || c >= 26 || cb_seeds_alpha_size[c] < 0)
+            return 0;
+        hash = hash * CABLAST_SEEDS_ALPHA_SIZE + cb_seeds_alpha_size[c];
+    }
+    p = seeds_file->offsets + 8 * (int64_t)hash;
+    *first = (int64_t)read_int_from_bytes(p, 8);
+    end = (int64_t)read_int_from_bytes(p + 8, 8);
+    return (int32_t)(end - *first);
+}
@@ -0,0 +1,53 @@
+#ifndef __CABLAST_SEEDS_FILE_H__
+#define __CABLAST_SEEDS_FILE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "seeds.h"
+
+/*coarse.seeds starts with this magic string followed by a byte with the
+ *version of the file's format, and then the seed size as a 4-byte integer.
+ *After that comes a table of 4^(seed size) + 1 8-byte offsets, one for each
+ *k-mer hash plus one past the end, and then the array of seed locations, each
+ *a 4-byte coarse sequence ID and a 4-byte residue index.  The locations of the
+ *k-mer with hash h are the entries of the array from offsets[h] up to but not
+ *including offsets[h+1], in the order they were added to the seeds table.
+ *All integers are big-endian, so the file can be mapped and searched without
+ *being parsed.
+ */
+#define CABLAST_SEEDS_MAGIC "CBLASTS"
+#define CABLAST_SEEDS_VERSION 2
+#define CABLAST_SEEDS_HEADER_SIZE 12
+
+/*A read-only memory map of a coarse.seeds file.  offsets and locs point into
+  the map at the offset table and the location array.*/
+struct cb_seeds_file {
+    unsigned char *bytes;
+    int64_t length;
+    int32_t seed_size;
+    int32_t num_hashes;
+    unsigned char *offsets;
+    unsigned char *locs;
+};
+
+void
+cb_seeds_file_write(struct cb_seeds *seeds, FILE *f, int32_t threads);
+
+int32_t
+cb_seeds_file_convert(FILE *in, FILE *out, int32_t seed_size,
+                      int32_t threads);
+
+struct cb_seeds_file *
+cb_seeds_file_init(FILE *f);
+
+void
+cb_seeds_file_free(struct cb_seeds_file *seeds_file);
+
+int64_t
+cb_seeds_file_count(struct cb_seeds_file *seeds_file, char *kmer);
+
+struct cb_seed_loc *
+cb_seeds_file_lookup(struct cb_seeds_file *seeds_file, char *kmer);
+
+#endif
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitpack.h"
+#include "coarse.h"
+#include "compressed.h"
+#include "decompression.h"
+#include "packed_seqs.h"
+#include "writer.h"
+
+/*The residues of the only coarse sequence of the database.*/
+char *coarse = "ACGTACGTTTGCAGGATCCATTAGACCGTATTGCAAGCTT";
+
+/*Each test is a compressed sequence with a link to the coarse residues from
+  start up to but not including end, or with no links at all if start is -1,
+  as cablast-compress makes for sequences too short to be searched for
+  seeds.*/
+struct {
+    char *name;
+    int32_t start;
+    int32_t end;
+} tests[] = {
+    { "whole", 0, 40 },
+    { "short", -1, -1 },
+    { "middle", 5, 20 },
+    { "empty", -1, -1 },
+    { NULL, 0, 0 }
+};
+
+/*The order the sequences of the tests are given to cb_compressed_write_binary
+  in, as when they are compressed by several threads.*/
+int32_t write_order[] = { 2, 0, 3, 1 };
+
+/*The IDs of the sequences to decompress by ID.*/
+int32_t chosen[] = { 3, 1, 2 };
+
+static FILE *
+temp_file(void)
+{
+    FILE *f;
+
+    if (NULL == (f = tmpfile())) {
+        printf("Could not create a temporary file.\n");
+        exit(1);
+    }
+    return f;
+}
+
+/*Makes a coarse database whose only sequence is "coarse", read from packed
+  residues in temporary files.*/
+static struct cb_coarse *
+coarse_db_init(void)
+{
+    struct cb_coarse *coarse_db;
+    struct cb_writer *w, *w_index;
+    FILE *f, *index;
+
+    f = temp_file();
+    index = temp_file();
+    w = cb_writer_init(f);
+    w_index = cb_writer_init(index);
+    cb_packed_seqs_write(w, w_index, coarse, strlen(coarse));
+    cb_writer_free(w);
+    cb_writer_free(w_index);
+    fflush(f);
+    fflush(index);
+
+    coarse_db = cb_coarse_init(0, NULL, NULL, NULL, NULL, NULL, f, index,
+                               NULL);
+    coarse_db->packed = cb_packed_seqs_init(f, index);
+    if (coarse_db->packed == NULL) {
+        printf("Could not map the packed sequences.\n");
+        exit(1);
+    }
+    return coarse_db;
+}
+
+/*Writes the sequences of the tests to a compressed database in temporary
+  files, in the order in write_order.*/
+static struct cb_compressed *
+compressed_db_init(void)
+{
+    struct cb_compressed *com_db;
+    struct cb_compressed_seq *cseq;
+    int i, j;
+
+    com_db = cb_compressed_init(temp_file(), temp_file(), temp_file());
+    output_format_header(CABLAST_COMPRESSED_MAGIC, CABLAST_COMPRESSED_VERSION,
+                         com_db->file_compressed);
+    for (j = 0; tests[j].name != NULL; j++) {
+        i = write_order[j];
+        cseq = cb_compressed_seq_init(i, tests[i].name);
+        if (tests[i].start >= 0)
+            cb_compressed_seq_addlink(cseq, cb_link_to_coarse_init_nodiff(
+                0, 0, tests[i].end - tests[i].start - 1,
+                tests[i].start, tests[i].end - 1, true));
+        cb_compressed_write_binary(com_db, cseq);
+    }
+    cb_writer_flush(com_db->writer_compressed);
+    cb_writer_flush(com_db->writer_index);
+    cb_writer_flush(com_db->writer_lengths);
+    return com_db;
+}
+
+/*Reads the next sequence written by cb_decompress_write from out and checks
+  that it is the sequence of test i.*/
+static void
+check_seq(FILE *out, int i)
+{
+    char line[256], expected[256];
+
+    sprintf(expected, "> %d; %s\n", i, tests[i].name);
+    if (NULL == fgets(line, sizeof(line), out) ||
+          strcmp(line, expected) != 0) {
+        printf("TEST %d FAILED\n", i);
+        printf("The header of '%s' should be '%.*s'.\n",
+               tests[i].name, (int)strlen(expected) - 1, expected);
+        exit(1);
+    }
+
+    if (tests[i].start >= 0)
+        sprintf(expected, "%.*s\n", tests[i].end - tests[i].start,
+                coarse + tests[i].start);
+    else
+        strcpy(expected, "\n");
+    if (NULL == fgets(line, sizeof(line), out) ||
+          strcmp(line, expected) != 0) {
+        printf("TEST %d FAILED\n", i);
+        printf("The residues of '%s' should be '%.*s'.\n",
+               tests[i].name, (int)strlen(expected) - 1, expected);
+        exit(1);
+    }
+}
+
+/*Checks that nothing was written to out after the last sequence.*/
+static void
+check_end(FILE *out, int i)
+{
+    char line[256];
+
+    if (NULL != fgets(line, sizeof(line), out)) {
+        printf("TEST %d FAILED\n", i);
+        printf("Nothing should be written after the last sequence.\n");
+        exit(1);
+    }
+    fclose(out);
+}
+
+int main(void)
+{
+    struct cb_coarse *coarse_db;
+    struct cb_compressed *com_db;
+    FILE *out;
+    int i, num_chosen;
+
+    coarse_db = coarse_db_init();
+    com_db = compressed_db_init();
+
+    /*Every sequence is written in order of ID...*/
+    out = temp_file();
+    cb_decompress_write(coarse_db, com_db, NULL, 0, out, 2);
+    rewind(out);
+    for (i = 0; tests[i].name != NULL; i++)
+        check_seq(out, i);
+    check_end(out, i);
+
+    /*...and the sequence with each ID is found with the index.*/
+    num_chosen = sizeof(chosen) / sizeof(*chosen);
+    out = temp_file();
+    cb_decompress_write(coarse_db, com_db, chosen, num_chosen, out, 2);
+    rewind(out);
+    for (i = 0; i < num_chosen; i++)
+        check_seq(out, chosen[i]);
+    check_end(out, i);
+
+    cb_packed_seqs_free(coarse_db->packed);
+
+    printf("ALL TESTS PASSED\n");
+    return 0;
+}
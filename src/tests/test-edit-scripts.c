@@ -0,0 +1,259 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coarse.h"
+#include "DNAutils.h"
+#include "edit_scripts.h"
+#include "packed_seqs.h"
+#include "writer.h"
+
+/*Each test is an alignment of an original sequence against a reference
+  sequence, with '-' for gaps, along with the reference without gaps.*/
+struct {
+    char *org;
+    char *ref;
+    char *residues;
+} tests[] = {
+    { "ACGTACGT", "ACGTACGT", "ACGTACGT" },
+    { "ACGAACGT", "ACGTACGT", "ACGTACGT" },
+    { "TTTTACGT", "ACGTACGT", "ACGTACGT" },
+    { "ACGTACGA", "ACGTACGT", "ACGTACGT" },
+    { "ACG--CGT", "ACGTACGT", "ACGTACGT" },
+    { "ACGTTTACGT", "ACG--TACGT", "ACGTACGT" },
+    { "ACGTNNNNNCGT", "ACGT---TACGT", "ACGTTACGT" },
+    { "AC-TAGGCCATT", "ACGTA--CCTTT", "ACGTACCTTT" },
+    { "GATTACAGATTACAGATTACA", "GATCACAGA--ACAGATTTCA",
+      "GATCACAGAACAGATTTCA" },
+    { NULL, NULL, NULL }
+};
+
+/*Each checkpoint test decodes every window of a long link, in the given
+  direction, starting from checkpoints taken every "interval" residues, and
+  compares it with a decode of the whole link without checkpoints.*/
+#define LINK_LENGTH 5000
+#define LINK_START 1000
+
+struct {
+    bool dir;
+    int32_t interval;
+} checkpoint_tests[] = {
+    { true, 50 },
+    { false, 50 },
+    { true, 7 },
+    { false, 7 },
+    { true, 0 }
+};
+
+int32_t windows[] = { 1, 64, 500, 0 };
+
+static unsigned long rand_state = 1;
+
+static int
+next_rand(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return (int)((rand_state >> 16) & 0x7fff);
+}
+
+/*Fills org and ref with a random alignment of LINK_LENGTH residues of ref
+  (given without gaps in "residues") with substitutions, deletions and
+  insertions, including runs of 'N'.  Returns the length of the alignment.*/
+static int
+random_alignment(char *residues, char *org, char *ref)
+{
+    int i, j, length = 0, r;
+
+    for (i = 0; i < LINK_LENGTH; i++)
+        residues[i] = "ACGT"[next_rand() % 4];
+    residues[LINK_LENGTH] = '\0';
+
+    for (i = 0; i < LINK_LENGTH; i++) {
+        r = next_rand() % 100;
+        if (r < 2) {
+            for (j = 0; j < 3; j++) {
+                org[length] = 'N';
+                ref[length++] = '-';
+            }
+        }
+        else if (r < 5) {
+            org[length] = "ACGT"[next_rand() % 4];
+            ref[length++] = '-';
+        }
+        if (r >= 5 && r < 8)
+            org[length] = '-';
+        else if (r >= 8 && r < 12)
+            org[length] = base_complement(residues[i]);
+        else
+            org[length] = residues[i];
+        ref[length++] = residues[i];
+    }
+    org[length] = '\0';
+    ref[length] = '\0';
+    return length;
+}
+
+/*Decodes residues start to start+length-1 of the original sequence of link
+  with decode_edit_script.*/
+static char *
+decode_window(struct cb_coarse *coarse_db, struct cb_link_to_coarse *link,
+              int start, int length)
+{
+    char *window;
+
+    window = malloc((length + 1)*sizeof(*window));
+    assert(window);
+    memset(window, '-', length);
+    window[length] = '\0';
+    decode_edit_script(window, length, start, coarse_db, link);
+    return window;
+}
+
+static void
+test_checkpoints(void)
+{
+    struct cb_coarse *coarse_db;
+    struct cb_link_to_coarse link;
+    struct cb_writer *w, *w_index;
+    FILE *f, *index;
+    char residues[LINK_LENGTH + 1], org[3*LINK_LENGTH], ref[3*LINK_LENGTH];
+    char *expected, *full, *window;
+    int i, j, length, start, end, original_length;
+
+    length = random_alignment(residues, org, ref);
+
+    f = tmpfile();
+    index = tmpfile();
+    if (f == NULL || index == NULL) {
+        printf("Could not create temporary files.\n");
+        exit(1);
+    }
+    w = cb_writer_init(f);
+    w_index = cb_writer_init(index);
+    cb_packed_seqs_write(w, w_index, residues, LINK_LENGTH);
+    cb_writer_free(w);
+    cb_writer_free(w_index);
+    fflush(f);
+    fflush(index);
+
+    coarse_db = cb_coarse_init(0, NULL, NULL, NULL, NULL, NULL, f, index,
+                               NULL);
+    coarse_db->packed = cb_packed_seqs_init(f, index);
+    if (coarse_db->packed == NULL) {
+        printf("Could not map the packed sequences.\n");
+        exit(1);
+    }
+
+    for (i = 0; checkpoint_tests[i].interval > 0; i++) {
+        expected = no_dashes(org);
+        original_length = strlen(expected);
+        if (!checkpoint_tests[i].dir) {
+            full = string_revcomp(expected, original_length);
+            free(expected);
+            expected = full;
+        }
+
+        link.coarse_seq_id = 0;
+        link.original_start = LINK_START;
+        link.original_end = LINK_START + original_length - 1;
+        link.coarse_start = 0;
+        link.coarse_end = LINK_LENGTH - 1;
+        link.diff = make_edit_script(org, ref, checkpoint_tests[i].dir,
+                                     length);
+        link.checkpoints = NULL;
+        link.num_checkpoints = 0;
+        link.next = NULL;
+
+        full = decode_window(coarse_db, &link, LINK_START, original_length);
+        if (strcmp(full, expected) != 0) {
+            printf("CHECKPOINT TEST %d FAILED\n", i);
+            printf("Decoding the whole link did not give back the original "
+                   "sequence.\n");
+            exit(1);
+        }
+
+        link.checkpoints = edit_script_checkpoints(link.diff,
+                                                   checkpoint_tests[i].interval,
+                                                   &link.num_checkpoints);
+        if (link.num_checkpoints == 0) {
+            printf("CHECKPOINT TEST %d FAILED\n", i);
+            printf("A link of %d residues should have checkpoints every %d "
+                   "residues.\n", original_length,
+                   checkpoint_tests[i].interval);
+            exit(1);
+        }
+
+        for (j = 0; windows[j] > 0; j++)
+            for (start = 0; start < original_length; start += 13) {
+                end = start + windows[j];
+                if (end > original_length)
+                    end = original_length;
+                window = decode_window(coarse_db, &link, LINK_START + start,
+                                       end - start);
+                if (strncmp(window, full + start, end - start) != 0) {
+                    printf("CHECKPOINT TEST %d FAILED\n", i);
+                    printf("Decoding residues %d to %d from a checkpoint gave "
+                           "'%s' instead of '%.*s'.\n", start, end - 1,
+                           window, end - start, full + start);
+                    exit(1);
+                }
+                free(window);
+            }
+
+        free(link.checkpoints);
+        free(link.diff);
+        free(full);
+        free(expected);
+    }
+
+    cb_packed_seqs_free(coarse_db->packed);
+    fclose(f);
+    fclose(index);
+}
+
+int main(void)
+{
+    char *script, *ascii, *converted, *decoded, *expected;
+    int i, length;
+
+    for (i = 0; tests[i].org != NULL; i++) {
+        expected = no_dashes(tests[i].org);
+        length = strlen(tests[i].org);
+
+        script = make_edit_script(tests[i].org, tests[i].ref, true, length);
+        decoded = read_edit_script(script, tests[i].residues,
+                                   strlen(tests[i].residues));
+        if (strcmp(decoded, expected) != 0) {
+            printf("TEST %d FAILED\n", i);
+            printf("Applying the edit script for '%s' against '%s' should "
+                   "yield '%s', but read_edit_script returned '%s'.\n",
+                   tests[i].org, tests[i].ref, expected, decoded);
+            exit(1);
+        }
+        free(decoded);
+
+        /*Scripts converted from the old ASCII format must be identical to
+          the scripts made directly.*/
+        ascii = edit_script_to_ASCII(script);
+        converted = edit_script_from_ASCII(ascii);
+        if (edit_script_size(converted) != edit_script_size(script) ||
+              memcmp(converted, script, edit_script_size(script)) != 0) {
+            printf("TEST %d FAILED\n", i);
+            printf("Converting the ASCII edit script '%s' for '%s' against "
+                   "'%s' did not give back the binary edit script.\n",
+                   ascii + 1, tests[i].org, tests[i].ref);
+            exit(1);
+        }
+
+        free(ascii);
+        free(converted);
+        free(script);
+        free(expected);
+    }
+
+    test_checkpoints();
+
+    printf("ALL TESTS PASSED\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fasta.h"
+
+/*Each test is the contents of a FASTA file followed by the names and residues
+  of the sequences that should be read from it.*/
+struct test {
+    char *file;
+    char *seqs[7];
+};
+
+struct test tests[] = {
+    {">a\nACGT\n", {"a", "ACGT", NULL}},
+    {">a\nAC\nGT\n>b\nTTTT\n", {"a", "ACGT", "b", "TTTT", NULL}},
+    {"> a b \r\nAC \r\n\tGT*\r\n", {"a b", "ACGT", NULL}},
+    {">a\nACGT", {"a", "ACGT", NULL}},
+    {">a\n\n>b\nA\n\nC\n", {"a", "", "b", "AC", NULL}},
+    {">a\nAJU*G\nO\n", {"a", "AXXXGX", NULL}},
+    {">a\nA*C\n>b\n>c\nG\n", {"a", "AXC", "b", "", "c", "G", NULL}},
+    {"", {NULL}},
+    {NULL, {NULL}}
+};
+
+static void
+check_seq(int test, int i, struct fasta_seq *seq, const char *how)
+{
+    if (tests[test].seqs[i] == NULL) {
+        if (seq != NULL) {
+            printf("TEST %d FAILED\n", test);
+            printf("%s read an extra sequence '%s'.\n", how, seq->name);
+            exit(1);
+        }
+        return;
+    }
+    if (seq == NULL) {
+        printf("TEST %d FAILED\n", test);
+        printf("%s did not read sequence '%s'.\n", how, tests[test].seqs[i]);
+        exit(1);
+    }
+    if (strcmp(seq->name, tests[test].seqs[i]) != 0 ||
+          strcmp(seq->seq, tests[test].seqs[i+1]) != 0) {
+        printf("TEST %d FAILED\n", test);
+        printf("%s read '%s' '%s', but it should be '%s' '%s'.\n", how,
+               seq->name, seq->seq, tests[test].seqs[i],
+               tests[test].seqs[i+1]);
+        exit(1);
+    }
+}
+
+static FILE *
+write_file(const char *contents)
+{
+    FILE *f;
+
+    if (NULL == (f = tmpfile())) {
+        printf("Could not create a temporary file.\n");
+        exit(1);
+    }
+    fputs(contents, f);
+    rewind(f);
+    return f;
+}
+
+int main(void)
+{
+    struct fasta_reader *reader;
+    struct fasta_seq *seq;
+    FILE *f;
+    char *file, *residues;
+    int test, i, length;
+
+    for (test = 0; tests[test].file != NULL; test++) {
+        f = write_file(tests[test].file);
+        reader = fasta_reader_init(f, FASTA_EXCLUDE_NCBI_BLOSUM62);
+        for (i = 0; i == 0 || tests[test].seqs[i-2] != NULL; i += 2) {
+            seq = fasta_reader_next(reader);
+            check_seq(test, i, seq, "fasta_reader_next");
+            if (seq != NULL)
+                fasta_free_seq(seq);
+        }
+        fasta_reader_free(reader);
+
+        rewind(f);
+        for (i = 0; i == 0 || tests[test].seqs[i-2] != NULL; i += 2) {
+            seq = fasta_read_next(f, FASTA_EXCLUDE_NCBI_BLOSUM62);
+            check_seq(test, i, seq, "fasta_read_next");
+            if (seq != NULL)
+                fasta_free_seq(seq);
+        }
+        fclose(f);
+    }
+
+    /*A sequence on one line that is longer than the reader's buffer.*/
+    length = 3 * FASTA_BUFFER_SIZE;
+    file = malloc(length + 20);
+    residues = malloc(length + 1);
+    if (file == NULL || residues == NULL) {
+        printf("Could not allocate a long sequence.\n");
+        exit(1);
+    }
+    for (i = 0; i < length; i++)
+        residues[i] = "ACGT"[i % 4];
+    residues[length] = '\0';
+    sprintf(file, ">long\n%s\n>b\nA\n", residues);
+    tests[test].seqs[0] = "long";
+    tests[test].seqs[1] = residues;
+    tests[test].seqs[2] = "b";
+    tests[test].seqs[3] = "A";
+    tests[test].seqs[4] = NULL;
+
+    f = write_file(file);
+    reader = fasta_reader_init(f, "");
+    for (i = 0; i == 0 || tests[test].seqs[i-2] != NULL; i += 2) {
+        seq = fasta_reader_next(reader);
+        check_seq(test, i, seq, "fasta_reader_next");
+        if (seq != NULL)
+            fasta_free_seq(seq);
+    }
+    fasta_reader_free(reader);
+    rewind(f);
+    for (i = 0; i == 0 || tests[test].seqs[i-2] != NULL; i += 2) {
+        seq = fasta_read_next(f, "");
+        check_seq(test, i, seq, "fasta_read_next");
+        if (seq != NULL)
+            fasta_free_seq(seq);
+    }
+    fclose(f);
+    free(file);
+    free(residues);
+
+    printf("ALL TESTS PASSED\n");
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "packed_seqs.h"
+
+/*Each test is a sequence that is packed and then read back one range at a
+  time, so every range that starts or ends inside of an exception is read.*/
+char *tests[] = {
+    "ACGT",
+    "A",
+    "GATTACA",
+    "NNNNACGTNNNN",
+    "ACGTNACGTRRYACG",
+    "NNNNNNNNNN",
+    "ACGTNNNNNNNNNNNNNNNNACGTNTTTT",
+    NULL
+};
+
+int main(void)
+{
+    struct cb_packed_seqs *packed;
+    struct cb_writer *w, *w_index;
+    FILE *f, *index;
+    char *residues;
+    int i, start, end, length;
+
+    f = tmpfile();
+    index = tmpfile();
+    if (f == NULL || index == NULL) {
+        printf("Could not create temporary files.\n");
+        exit(1);
+    }
+
+    w = cb_writer_init(f);
+    w_index = cb_writer_init(index);
+    for (i = 0; tests[i] != NULL; i++)
+        cb_packed_seqs_write(w, w_index, tests[i], strlen(tests[i]));
+    cb_writer_free(w);
+    cb_writer_free(w_index);
+    fflush(f);
+    fflush(index);
+
+    packed = cb_packed_seqs_init(f, index);
+    if (packed == NULL) {
+        printf("Could not map the packed sequences.\n");
+        exit(1);
+    }
+
+    for (i = 0; tests[i] != NULL; i++) {
+        length = strlen(tests[i]);
+        if (cb_packed_seqs_length(packed, i) != length) {
+            printf("TEST %d FAILED\n", i);
+            printf("The length of '%s' should be %d, but "
+                   "cb_packed_seqs_length returned %d.\n",
+                   tests[i], length, cb_packed_seqs_length(packed, i));
+            exit(1);
+        }
+        for (start = 0; start <= length; start++)
+            for (end = start; end <= length + 1; end++) {
+                residues = cb_packed_seqs_get(packed, i, start, end);
+                if ((int)strlen(residues) != (end > length ? length : end) -
+                                             start ||
+                      strncmp(residues, tests[i] + start,
+                              strlen(residues)) != 0) {
+                    printf("TEST %d FAILED\n", i);
+                    printf("Residues %d to %d of '%s' should not be '%s'.\n",
+                           start, end, tests[i], residues);
+                    exit(1);
+                }
+                free(residues);
+            }
+    }
+    if (cb_packed_seqs_get(packed, i, 0, 1) != NULL) {
+        printf("TEST %d FAILED\n", i);
+        printf("Reading a sequence that does not exist should fail.\n");
+        exit(1);
+    }
+
+    cb_packed_seqs_free(packed);
+    fclose(f);
+    fclose(index);
+
+    printf("ALL TESTS PASSED\n");
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitpack.h"
+#include "writer.h"
+
+/*Creates a writer that appends to f from its current position.*/
+struct cb_writer *
+cb_writer_init(FILE *f)
+{
+    struct cb_writer *w;
+
+    w = malloc(sizeof(*w));
+    assert(w);
+
+    w->buf = malloc(CABLAST_WRITER_BUFFER_SIZE*sizeof(*w->buf));
+    assert(w->buf);
+
+    w->f = f;
+    w->used = 0;
+    w->offset = ftell(f);
+
+    return w;
+}
+
+/*Writes out whatever is left in the buffer and frees the writer.  The file is
+  not closed.*/
+void
+cb_writer_free(struct cb_writer *w)
+{
+    if (w == NULL)
+        return;
+    cb_writer_flush(w);
+    free(w->buf);
+    free(w);
+}
+
+void
+cb_writer_flush(struct cb_writer *w)
+{
+    if (w->used > 0 &&
+          fwrite(w->buf, sizeof(*w->buf), w->used, w->f) != (size_t)w->used) {
+        fprintf(stderr, "Could not write to a database file.\n");
+        exit(1);
+    }
+    w->offset += w->used;
+    w->used = 0;
+}
+
+/*Returns the offset in the file of the next byte to be written.*/
+int64_t
+cb_writer_tell(struct cb_writer *w)
+{
+    return w->offset + w->used;
+}
+
+/*Writes length bytes.  Blocks at least as large as the buffer skip it.*/
+void
+cb_writer_bytes(struct cb_writer *w, const char *bytes, int32_t length)
+{
+    if (w->used + length > CABLAST_WRITER_BUFFER_SIZE)
+        cb_writer_flush(w);
+    if (length >= CABLAST_WRITER_BUFFER_SIZE) {
+        if (fwrite(bytes, sizeof(*bytes), length, w->f) != (size_t)length) {
+            fprintf(stderr, "Could not write to a database file.\n");
+            exit(1);
+        }
+        w->offset += length;
+    }
+    else {
+        memcpy(w->buf + w->used, bytes, length);
+        w->used += length;
+    }
+}
+
+void
+cb_writer_string(struct cb_writer *w, const char *s)
+{
+    cb_writer_bytes(w, s, strlen(s));
+}
+
+void
+cb_writer_char(struct cb_writer *w, char c)
+{
+    if (w->used == CABLAST_WRITER_BUFFER_SIZE)
+        cb_writer_flush(w);
+    w->buf[w->used++] = c;
+}
+
+/*Writes the lowest "bytes" bytes of n, highest byte first, like
+  output_int_to_file.*/
+void
+cb_writer_int(struct cb_writer *w, uint64_t n, int bytes)
+{
+    char b[8];
+    int i;
+
+    for (i = bytes - 1; i >= 0; i--, n >>= 8)
+        b[i] = (char)(n & 0xff);
+    cb_writer_bytes(w, b, bytes);
+}
+
+void
+cb_writer_varint(struct cb_writer *w, uint32_t n)
+{
+    char b[5];
+
+    cb_writer_bytes(w, b, put_varint(b, 0, n));
+}
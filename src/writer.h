@@ -0,0 +1,51 @@
+#ifndef __CABLAST_WRITER_H__
+#define __CABLAST_WRITER_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define CABLAST_WRITER_BUFFER_SIZE (1 << 20)
+
+/*A buffer in front of a database file that is being written.  Bytes are
+ *copied into the buffer and written to the file in large blocks, and the
+ *writer keeps track of its offset in the file so that index files can be
+ *written without calling ftell.  Fixed-size integers are big-endian like the
+ *rest of the database files.
+ */
+struct cb_writer {
+    FILE *f;
+    char *buf;
+    int32_t used;
+
+    /*The offset in the file of the first byte in the buffer.*/
+    int64_t offset;
+};
+
+struct cb_writer *
+cb_writer_init(FILE *f);
+
+void
+cb_writer_free(struct cb_writer *w);
+
+void
+cb_writer_flush(struct cb_writer *w);
+
+int64_t
+cb_writer_tell(struct cb_writer *w);
+
+void
+cb_writer_bytes(struct cb_writer *w, const char *bytes, int32_t length);
+
+void
+cb_writer_string(struct cb_writer *w, const char *s);
+
+void
+cb_writer_char(struct cb_writer *w, char c);
+
+void
+cb_writer_int(struct cb_writer *w, uint64_t n, int bytes);
+
+void
+cb_writer_varint(struct cb_writer *w, uint32_t n);
+
+#endif
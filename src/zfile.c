@@ -0,0 +1,355 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zfile.h"
+
+/*The blocks of a batch that one thread inflates: every threads-th block
+  starting with the thread's index.*/
+struct bgzf_part {
+    struct cb_zfile *zf;
+    int32_t index;
+};
+
+static void
+fill_in(struct cb_zfile *zf, int32_t want);
+
+static bool
+is_bgzf_header(unsigned char *p, int32_t length);
+
+static int32_t
+read_gzip(struct cb_zfile *zf, char *buf, int32_t length);
+
+static int32_t
+read_bgzf(struct cb_zfile *zf, char *buf, int32_t length);
+
+static void
+read_batch(struct cb_zfile *zf);
+
+static void *
+inflate_part(void *data);
+
+static void
+inflate_block(z_stream *stream, struct cb_bgzf_block *block);
+
+/*Opens a file for reading, or stdin if file_name is "-".  BGZF files are
+  inflated with up to "threads" threads.*/
+struct cb_zfile *
+cb_zfile_open(const char *file_name, int32_t threads)
+{
+    struct cb_zfile *zf;
+    int32_t i;
+
+    zf = malloc(sizeof(*zf));
+    assert(zf);
+
+    if (0 == strcmp(file_name, "-"))
+        zf->f = stdin;
+    else if (NULL == (zf->f = fopen(file_name, "rb"))) {
+        fprintf(stderr, "Could not open '%s' for reading.\n", file_name);
+        exit(1);
+    }
+
+    zf->in = malloc(CABLAST_ZFILE_BUFFER_SIZE * sizeof(*zf->in));
+    assert(zf->in);
+    zf->in_pos = 0;
+    zf->in_end = 0;
+    zf->in_eof = false;
+    zf->stream_end = false;
+    zf->threads = threads < 1 ? 1 : threads;
+    zf->blocks = NULL;
+    zf->num_blocks = 0;
+    zf->block = 0;
+    zf->block_pos = 0;
+    zf->streams = NULL;
+
+    fill_in(zf, 18);
+    if (is_bgzf_header(zf->in, zf->in_end)) {
+        zf->format = CABLAST_ZFILE_BGZF;
+
+        zf->blocks = malloc(zf->threads * CABLAST_BGZF_BATCH *
+                            sizeof(*zf->blocks));
+        assert(zf->blocks);
+        for (i = 0; i < zf->threads * CABLAST_BGZF_BATCH; i++) {
+            zf->blocks[i].in = malloc(CABLAST_BGZF_BLOCK_SIZE *
+                                      sizeof(*zf->blocks[i].in));
+            assert(zf->blocks[i].in);
+            zf->blocks[i].out = malloc(CABLAST_BGZF_BLOCK_SIZE *
+                                       sizeof(*zf->blocks[i].out));
+            assert(zf->blocks[i].out);
+        }
+
+        zf->streams = malloc(zf->threads * sizeof(*zf->streams));
+        assert(zf->streams);
+        for (i = 0; i < zf->threads; i++) {
+            memset(&zf->streams[i], 0, sizeof(zf->streams[i]));
+            if (Z_OK != inflateInit2(&zf->streams[i], -15)) {
+                fprintf(stderr, "Could not start zlib.\n");
+                exit(1);
+            }
+        }
+    }
+    else if (zf->in_end >= 2 && zf->in[0] == 0x1f && zf->in[1] == 0x8b) {
+        zf->format = CABLAST_ZFILE_GZIP;
+
+        memset(&zf->stream, 0, sizeof(zf->stream));
+        if (Z_OK != inflateInit2(&zf->stream, 15 + 16)) {
+            fprintf(stderr, "Could not start zlib.\n");
+            exit(1);
+        }
+    }
+    else
+        zf->format = CABLAST_ZFILE_PLAIN;
+
+    return zf;
+}
+
+/*Reads up to length uncompressed bytes into buf and returns the number read,
+  which is less than length only at the end of the file.*/
+int32_t
+cb_zfile_read(struct cb_zfile *zf, char *buf, int32_t length)
+{
+    int32_t got;
+
+    if (zf->format == CABLAST_ZFILE_GZIP)
+        return read_gzip(zf, buf, length);
+    if (zf->format == CABLAST_ZFILE_BGZF)
+        return read_bgzf(zf, buf, length);
+
+    got = zf->in_end - zf->in_pos;
+    if (got > length)
+        got = length;
+    memcpy(buf, zf->in + zf->in_pos, got);
+    zf->in_pos += got;
+    if (got < length)
+        got += fread(buf + got, sizeof(*buf), length - got, zf->f);
+    return got;
+}
+
+/*Closes a file and frees it.  stdin is not closed.*/
+void
+cb_zfile_close(struct cb_zfile *zf)
+{
+    int32_t i;
+
+    if (zf->format == CABLAST_ZFILE_GZIP)
+        inflateEnd(&zf->stream);
+    if (zf->format == CABLAST_ZFILE_BGZF) {
+        for (i = 0; i < zf->threads * CABLAST_BGZF_BATCH; i++) {
+            free(zf->blocks[i].in);
+            free(zf->blocks[i].out);
+        }
+        for (i = 0; i < zf->threads; i++)
+            inflateEnd(&zf->streams[i]);
+        free(zf->blocks);
+        free(zf->streams);
+    }
+    if (zf->f != stdin)
+        fclose(zf->f);
+    free(zf->in);
+    free(zf);
+}
+
+/*Reads from the file until at least "want" unused bytes are in the input
+  buffer or the file ends.*/
+static void
+fill_in(struct cb_zfile *zf, int32_t want)
+{
+    int32_t got;
+
+    if (zf->in_end - zf->in_pos >= want || zf->in_eof)
+        return;
+
+    memmove(zf->in, zf->in + zf->in_pos, zf->in_end - zf->in_pos);
+    zf->in_end -= zf->in_pos;
+    zf->in_pos = 0;
+    while (zf->in_end < want && !zf->in_eof) {
+        got = fread(zf->in + zf->in_end, sizeof(*zf->in),
+                    CABLAST_ZFILE_BUFFER_SIZE - zf->in_end, zf->f);
+        zf->in_end += got;
+        zf->in_eof = got == 0;
+    }
+}
+
+/*Returns true if p starts with the header of a BGZF block: a gzip header
+  whose only extra field is "BC", which holds the size of the block.*/
+static bool
+is_bgzf_header(unsigned char *p, int32_t length)
+{
+    return length >= 18 && p[0] == 0x1f && p[1] == 0x8b && p[2] == 8 &&
+           (p[3] & 4) != 0 && p[10] == 6 && p[11] == 0 &&
+           p[12] == 'B' && p[13] == 'C' && p[14] == 2 && p[15] == 0;
+}
+
+/*Inflates gzip members one after another.  Anything after the last member
+  that is not another gzip header is ignored, like gzip does.*/
+static int32_t
+read_gzip(struct cb_zfile *zf, char *buf, int32_t length)
+{
+    int ret;
+
+    zf->stream.next_out = (unsigned char *)buf;
+    zf->stream.avail_out = length;
+    while (zf->stream.avail_out > 0 && !zf->stream_end) {
+        fill_in(zf, 1);
+        zf->stream.next_in = zf->in + zf->in_pos;
+        zf->stream.avail_in = zf->in_end - zf->in_pos;
+
+        ret = inflate(&zf->stream, Z_NO_FLUSH);
+        zf->in_pos = zf->in_end - zf->stream.avail_in;
+
+        if (ret == Z_STREAM_END) {
+            fill_in(zf, 2);
+            if (zf->in_end - zf->in_pos >= 2 &&
+                  zf->in[zf->in_pos] == 0x1f && zf->in[zf->in_pos+1] == 0x8b)
+                inflateReset(&zf->stream);
+            else
+                zf->stream_end = true;
+        }
+        else if (ret != Z_OK && !(ret == Z_BUF_ERROR && !zf->in_eof)) {
+            fprintf(stderr, "Could not inflate a gzip file: %s\n",
+                    ret == Z_BUF_ERROR ? "unexpected end of file" :
+                    zf->stream.msg != NULL ? zf->stream.msg : "zlib error");
+            exit(1);
+        }
+    }
+    return length - zf->stream.avail_out;
+}
+
+static int32_t
+read_bgzf(struct cb_zfile *zf, char *buf, int32_t length)
+{
+    struct cb_bgzf_block *block;
+    int32_t got = 0, n;
+
+    while (got < length) {
+        if (zf->block == zf->num_blocks) {
+            read_batch(zf);
+            if (zf->num_blocks == 0)
+                break;
+        }
+        block = &zf->blocks[zf->block];
+        n = block->out_length - zf->block_pos;
+        if (n > length - got)
+            n = length - got;
+        memcpy(buf + got, block->out + zf->block_pos, n);
+        got += n;
+        zf->block_pos += n;
+        if (zf->block_pos == block->out_length) {
+            zf->block++;
+            zf->block_pos = 0;
+        }
+    }
+    return got;
+}
+
+/*Reads the next batch of BGZF blocks from the file and inflates them, with
+  one thread per CABLAST_BGZF_BATCH blocks.*/
+static void
+read_batch(struct cb_zfile *zf)
+{
+    struct cb_bgzf_block *block;
+    struct bgzf_part *parts;
+    pthread_t *ids;
+    int32_t i, threads, errno;
+
+    zf->num_blocks = 0;
+    zf->block = 0;
+    zf->block_pos = 0;
+    while (zf->num_blocks < zf->threads * CABLAST_BGZF_BATCH) {
+        fill_in(zf, 18);
+        if (zf->in_pos == zf->in_end)
+            break;
+        if (!is_bgzf_header(zf->in + zf->in_pos, zf->in_end - zf->in_pos)) {
+            fprintf(stderr, "Could not read a BGZF block header.\n");
+            exit(1);
+        }
+
+        block = &zf->blocks[zf->num_blocks++];
+        block->in_length = (zf->in[zf->in_pos+16] |
+                            (zf->in[zf->in_pos+17] << 8)) + 1;
+        fill_in(zf, block->in_length);
+        if (block->in_length < 26 ||
+              zf->in_end - zf->in_pos < block->in_length) {
+            fprintf(stderr, "Could not read a BGZF block: it is truncated.\n");
+            exit(1);
+        }
+        memcpy(block->in, zf->in + zf->in_pos, block->in_length);
+        zf->in_pos += block->in_length;
+    }
+
+    threads = (zf->num_blocks + CABLAST_BGZF_BATCH - 1) / CABLAST_BGZF_BATCH;
+    if (threads <= 1) {
+        for (i = 0; i < zf->num_blocks; i++)
+            inflate_block(&zf->streams[0], &zf->blocks[i]);
+        return;
+    }
+
+    parts = malloc(threads * sizeof(*parts));
+    assert(parts);
+    ids = malloc(threads * sizeof(*ids));
+    assert(ids);
+    for (i = 0; i < threads; i++) {
+        parts[i].zf = zf;
+        parts[i].index = i;
+        if (0 != (errno = pthread_create(&ids[i], NULL, inflate_part,
+                                         &parts[i]))) {
+            fprintf(stderr,
+                "read_batch: Could not start thread. Errno: %d\n", errno);
+            exit(1);
+        }
+    }
+    for (i = 0; i < threads; i++)
+        if (0 != (errno = pthread_join(ids[i], NULL))) {
+            fprintf(stderr,
+                "read_batch: Could not join thread. Errno: %d\n", errno);
+            exit(1);
+        }
+    free(parts);
+    free(ids);
+}
+
+static void *
+inflate_part(void *data)
+{
+    struct bgzf_part *part = (struct bgzf_part *)data;
+    int32_t threads, i;
+
+    threads = (part->zf->num_blocks + CABLAST_BGZF_BATCH - 1) /
+              CABLAST_BGZF_BATCH;
+    for (i = part->index; i < part->zf->num_blocks; i += threads)
+        inflate_block(&part->zf->streams[part->index], &part->zf->blocks[i]);
+    return NULL;
+}
+
+/*Inflates the deflate data between a block's 18-byte header and its 8-byte
+  trailer, and checks it against the CRC and size in the trailer.*/
+static void
+inflate_block(z_stream *stream, struct cb_bgzf_block *block)
+{
+    unsigned char *trailer;
+    uint32_t crc, size;
+    int ret;
+
+    inflateReset(stream);
+    stream->next_in = block->in + 18;
+    stream->avail_in = block->in_length - 26;
+    stream->next_out = block->out;
+    stream->avail_out = CABLAST_BGZF_BLOCK_SIZE;
+    ret = inflate(stream, Z_FINISH);
+    block->out_length = CABLAST_BGZF_BLOCK_SIZE - stream->avail_out;
+
+    trailer = block->in + block->in_length - 8;
+    crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) |
+          ((uint32_t)trailer[3] << 24);
+    size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) |
+           ((uint32_t)trailer[7] << 24);
+    if (ret != Z_STREAM_END || size != (uint32_t)block->out_length ||
+          crc != crc32(crc32(0, Z_NULL, 0), block->out, block->out_length)) {
+        fprintf(stderr, "Could not inflate a BGZF block: it is corrupt.\n");
+        exit(1);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef __CABLAST_ZFILE_H__
+#define __CABLAST_ZFILE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <zlib.h>
+
+#define CABLAST_ZFILE_PLAIN 0
+#define CABLAST_ZFILE_GZIP 1
+#define CABLAST_ZFILE_BGZF 2
+
+/*Compressed bytes are read from the file this many at a time.  It has to be
+  at least as big as the largest BGZF block.*/
+#define CABLAST_ZFILE_BUFFER_SIZE (1 << 17)
+
+/*The largest compressed or uncompressed size of a BGZF block.*/
+#define CABLAST_BGZF_BLOCK_SIZE 65536
+
+/*The number of BGZF blocks each thread inflates in a batch.*/
+#define CABLAST_BGZF_BATCH 8
+
+struct cb_bgzf_block {
+    unsigned char *in;
+    int32_t in_length;
+    unsigned char *out;
+    int32_t out_length;
+};
+
+/*A file that is read as a stream of uncompressed bytes whether it is plain,
+ *compressed with gzip (including files of several gzip members) or
+ *compressed with bgzip.  The format is found from the first bytes of the
+ *file, so it works for stdin too.
+ *
+ *BGZF files are a series of gzip members of at most 64 KB that each record
+ *their compressed size, so batches of blocks are read and inflated by
+ *several threads at once and then handed out in order.
+ */
+struct cb_zfile {
+    FILE *f;
+    int32_t format;
+
+    /*Bytes read from f from in_pos up to in_end have not been used yet.*/
+    unsigned char *in;
+    int32_t in_pos;
+    int32_t in_end;
+    bool in_eof;
+
+    /*The inflater for gzip files, and whether it is done.*/
+    z_stream stream;
+    bool stream_end;
+
+    /*The current batch of BGZF blocks, of which the next byte to hand out is
+      at block_pos in blocks[block].  There is one inflater per thread.*/
+    int32_t threads;
+    struct cb_bgzf_block *blocks;
+    int32_t num_blocks;
+    int32_t block;
+    int32_t block_pos;
+    z_stream *streams;
+};
+
+struct cb_zfile *
+cb_zfile_open(const char *file_name, int32_t threads);
+
+int32_t
+cb_zfile_read(struct cb_zfile *zf, char *buf, int32_t length);
+
+void
+cb_zfile_close(struct cb_zfile *zf);
+
+#endif